@@ -0,0 +1,120 @@
+#include "../src/Blit.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <algorithm>
+
+// Compares the compositing kernels (every ISA this CPU supports) against the gd
+// calls they replace, on a 1920x1080 frame, and reports the average cost as CSV.
+//
+// Usage: bin/BlitBench [ITERATIONS] [OUTPUT.csv]
+
+static const int WIDTH = 1920, HEIGHT = 1080;
+static const int STAGE_WIDTH = 500, STAGE_HEIGHT = 600; // about the size of data/stageN.png
+
+static gdImagePtr randomImage(int w, int h, bool alpha){
+	gdImagePtr im = gdImageCreateTrueColor(w, h);
+	for(int y = 0; y < h; y++){
+		for(int x = 0; x < w; x++){
+			int a = (alpha ? rand() % (gdAlphaMax + 1) : 0);
+			im->tpixels[y][x] = (a << 24) | (rand() & 0xFFFFFF);
+		}
+	}
+	return im;
+}
+
+static double timeIt(unsigned int iterations, std::function<void()> fn){
+	fn(); // warm up
+	auto start = std::chrono::steady_clock::now();
+	for(unsigned int i = 0; i < iterations; i++) fn();
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+static unsigned long long checksum(gdImagePtr im){
+	unsigned long long sum = 0;
+	for(int y = 0; y < im->sy; y++){
+		for(int x = 0; x < im->sx; x++) sum = sum * 31 + (unsigned int)(im->tpixels[y][x] & 0x00FFFFFF);
+	}
+	return sum;
+}
+
+int main(int argc, char** argv){
+	unsigned int iterations = (argc > 1 ? atoi(argv[1]) : 200);
+	std::ofstream file;
+	if(argc > 2){
+		file.open(argv[2]);
+		if(!file.is_open()){
+			std::cerr << "Error: Could not open '" << argv[2] << "' for writing." << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& out = (argc > 2 ? file : std::cout);
+
+	srand(1);
+	gdImagePtr background = randomImage(WIDTH, HEIGHT, false);
+	gdImagePtr stage = randomImage(STAGE_WIDTH, STAGE_HEIGHT, true);
+	gdImagePtr frame = gdImageCreateTrueColor(WIDTH, HEIGHT);
+	const int color = 0x00418F4B;
+
+	out << "op,impl,iterations,us_per_op" << std::endl;
+	out << std::fixed << std::setprecision(2);
+	auto report = [&](const std::string& op, const std::string& impl, double us){
+		out << op << "," << impl << "," << iterations << "," << us << std::endl;
+	};
+
+	// gd equivalents of each operation. //
+	gdImageAlphaBlending(frame, 1);
+	report("copy_background", "gd", timeIt(iterations, [&]{ gdImageCopy(frame, background, 0, 0, 0, 0, WIDTH, HEIGHT); }));
+	report("blend_stage", "gd", timeIt(iterations, [&]{ gdImageCopy(frame, stage, 1375, 100, 0, 0, STAGE_WIDTH, STAGE_HEIGHT); }));
+	report("fill_progress_boxes", "gd", timeIt(iterations, [&]{
+		gdPoint pts[4];
+		for(int i = 0, x = 298; i < 7; i++, x += 75){
+			pts[0].x = x; pts[0].y = 305;
+			pts[1].x = x + 50; pts[1].y = 305;
+			pts[2].x = x + 50; pts[2].y = 355;
+			pts[3].x = x; pts[3].y = 355;
+			gdImageFilledPolygon(frame, pts, 4, color);
+		}
+	}));
+
+	// Our kernels, for every ISA the CPU supports. //
+	unsigned long long reference[3] = {0, 0, 0};
+	for(int isa = BLIT_SCALAR; isa <= BLIT_AVX2; isa++){
+		if(!blitSupported(BlitIsa(isa))) continue;
+		const BlitKernels& k = blitKernels(BlitIsa(isa));
+		unsigned long long sums[3];
+		double us;
+
+		us = timeIt(iterations, [&]{ blitOpaque(frame, background, 0, 0, k); });
+		sums[0] = checksum(frame);
+		report("copy_background", k.name, us);
+
+		// Blend onto a fresh copy of the background each time so results are comparable.
+		blitOpaque(frame, background, 0, 0, k);
+		blitAlpha(frame, stage, 1375, 100, k);
+		sums[1] = checksum(frame);
+		us = timeIt(iterations, [&]{ blitAlpha(frame, stage, 1375, 100, k); });
+		report("blend_stage", k.name, us);
+
+		us = timeIt(iterations, [&]{
+			for(int i = 0, x = 298; i < 7; i++, x += 75) fillRect(frame, x, 305, x + 50, 355, color, k);
+		});
+		sums[2] = checksum(frame);
+		report("fill_progress_boxes", k.name, us);
+
+		if(isa == BLIT_SCALAR){
+			std::copy(sums, sums + 3, reference);
+		} else if(!std::equal(sums, sums + 3, reference)){
+			std::cerr << "Warning: " << k.name << " kernels do not match the scalar output!" << std::endl;
+		}
+	}
+
+	gdImageDestroy(frame);
+	gdImageDestroy(stage);
+	gdImageDestroy(background);
+	return 0;
+}
@@ -0,0 +1,166 @@
+#include "../src/Game.h"
+#include <cstdlib>
+#include <new>
+
+// Renders representative game states without an Airplay device and reports the
+// per-phase cost of getCurrentGameImage as CSV.
+//
+// Usage: bin/RenderBench [ITERATIONS] [OUTPUT.csv]   (run from the repository root)
+
+// Count every C++ heap allocation so steady-state rendering can be checked to allocate nothing.
+static std::atomic<unsigned long long> allocations(0);
+
+void* operator new(size_t n){
+	++allocations;
+	void* p = std::malloc(n ? n : 1);
+	if(!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	std::free(p);
+}
+
+// Count malloc calls too, which also sees gd, libjpeg and FreeType. Only glibc lets the
+// executable interpose malloc this simply; elsewhere the column is left empty.
+static std::atomic<unsigned long long> mallocs(0);
+#ifdef __GLIBC__
+#define COUNTS_MALLOC 1
+extern "C" {
+	void* __libc_malloc(size_t n);
+	void* __libc_calloc(size_t n, size_t size);
+	void* __libc_realloc(void* p, size_t n);
+	void __libc_free(void* p);
+
+	void* malloc(size_t n){
+		++mallocs;
+		return __libc_malloc(n);
+	}
+	void* calloc(size_t n, size_t size){
+		++mallocs;
+		return __libc_calloc(n, size);
+	}
+	void* realloc(void* p, size_t n){
+		++mallocs;
+		return __libc_realloc(p, n);
+	}
+	void free(void* p){
+		__libc_free(p);
+	}
+}
+#else
+#define COUNTS_MALLOC 0
+#endif
+
+struct BenchState {
+	std::string name;
+	GameMode mode;
+	std::string word;
+	std::string guessed;
+	bool result_screen;
+	bool waiting_for_word;
+	int last_result;
+	int level_diff;
+};
+
+class RenderBench {
+	private:
+		Game& game;
+		std::shared_ptr<GameAssets> assets;
+	public:
+		RenderBench(Game& g, std::shared_ptr<GameAssets> a) : game(g), assets(a){ }
+
+		// The snapshot the game would publish in this state.
+		GameSnapshot snapshot(const BenchState& state){
+			std::shared_ptr<const Wordlist> list = assets->getWordlist();
+			GameSnapshot snap;
+			snap.mode = state.mode;
+			snap.level = 10;
+			snap.score = 42;
+			snap.levelDiff = state.level_diff;
+			snap.lastGameResult = state.last_result;
+			snap.waitingForWord = state.waiting_for_word;
+			snap.word = state.word;
+			snap.wordRank = list->getRank(state.word);
+			snap.wordCount = (uint32_t)list->getSortedWords().size();
+			snap.guessed = wordLetterMask(state.guessed);
+			snap.incorrect = snap.guessed & ~wordLetterMask(state.word);
+			for(char c : state.word){
+				if(snap.blankedWord.length()) snap.blankedWord.push_back(' ');
+				snap.blankedWord.push_back((snap.guessed & letterBit(c)) ? c : '_');
+			}
+			return snap;
+		}
+
+		RenderProfile run(const BenchState& state, unsigned int iterations, size_t& bytes, unsigned long long& allocs, unsigned long long& mallocCalls){
+			RenderProfile profile;
+			std::string frame;
+			const GameSnapshot snap = snapshot(state);
+			game.renderGameImage(snap, state.result_screen, frame); // warm up font and image caches, size the buffers
+			game.setRenderProfile(&profile);
+			unsigned long long before = allocations;
+			unsigned long long mallocsBefore = mallocs;
+			for(unsigned int i = 0; i < iterations; i++){
+				game.renderGameImage(snap, state.result_screen, frame);
+			}
+			allocs = allocations - before;
+			mallocCalls = mallocs - mallocsBefore;
+			game.setRenderProfile(nullptr);
+			bytes = frame.length();
+			return profile;
+		}
+
+		unsigned int getFramebuffers(){ return assets->frames->getAllocations(); }
+};
+
+int main(int argc, char** argv){
+	unsigned int iterations = (argc > 1 ? atoi(argv[1]) : 20);
+	std::ofstream file;
+	if(argc > 2){
+		file.open(argv[2]);
+		if(!file.is_open()){
+			std::cerr << "Error: Could not open '" << argv[2] << "' for writing." << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& out = (argc > 2 ? file : std::cout);
+
+	// Build the representative states. //
+	std::vector<BenchState> states;
+	const std::string misses = "qzjxvkw"; // none of these are in the mid-game word
+	for(unsigned int i = 0; i <= GUESS_LIMIT; i++){
+		std::stringstream name;
+		name << "midgame_" << i << "_misses";
+		states.push_back({name.str(), MODE_COMPUTER_PICKS_WORD, "hangman", "an" + misses.substr(0, i), false, false, -1, 0});
+	}
+	states.push_back({"short_word", MODE_COMPUTER_PICKS_WORD, "abbey", "e", false, false, -1, 0});
+	states.push_back({"long_word", MODE_COMPUTER_PICKS_WORD, "pneumonoultramicroscopicsilicovolcanoconiosis", "eo", false, false, -1, 0});
+	states.push_back({"result_level_up", MODE_COMPUTER_PICKS_WORD, "hangman", "hangm", true, false, 1, 1});
+	states.push_back({"result_level_down", MODE_COMPUTER_PICKS_WORD, "hangman", misses, true, false, 0, -1});
+	states.push_back({"waiting_for_word", MODE_USER_PICKS_WORD, "", "", false, true, -1, 0});
+
+	// Render each state and report the average cost per frame. //
+	std::shared_ptr<GameAssets> assets = std::make_shared<GameAssets>();
+	Game game(nullptr, assets);
+	game.load();
+	RenderBench bench(game, assets);
+	out << "state,iterations,layout_us,composite_us,text_us,encode_us,total_us,bytes,allocs_per_frame,mallocs_per_frame,framebuffers" << std::endl;
+	out << std::fixed << std::setprecision(1);
+	for(const BenchState& state : states){
+		size_t bytes = 0;
+		unsigned long long allocs = 0, mallocCalls = 0;
+		RenderProfile p = bench.run(state, iterations, bytes, allocs, mallocCalls);
+		double n = (double)std::max(1ULL, p.frames);
+		out << state.name << "," << p.frames;
+		out << "," << p.layout / n << "," << p.composite / n << "," << p.text / n << "," << p.encode / n;
+		out << "," << (p.layout + p.composite + p.text + p.encode) / n << "," << bytes;
+		out << "," << allocs / n << ",";
+		if(COUNTS_MALLOC) out << mallocCalls / n;
+		out << "," << bench.getFramebuffers() << std::endl;
+	}
+	return 0;
+}
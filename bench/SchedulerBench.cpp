@@ -0,0 +1,88 @@
+#include "../src/Scheduler.h"
+#include "../src/Random.h"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+// Runs many simulated games on one scheduler, each a chain of continuations that waits
+// out a round delay and then does a little work, like a game between rounds. Reports how
+// late the timers fire (the precision of round timing) as CSV.
+//
+// Usage: bin/SchedulerBench [GAMES] [ROUNDS] [OUTPUT.csv]
+
+typedef std::chrono::steady_clock Clock;
+
+struct SimGame {
+	Clock::time_point deadline;
+	unsigned int roundsLeft;
+};
+
+static Scheduler* scheduler;
+static std::mutex doneMutex;
+static std::condition_variable doneCond;
+static std::vector<double> lateness; // milliseconds, one per round
+static unsigned int running;
+
+static void nextRound(SimGame* game){
+	if(game->roundsLeft-- == 0){
+		std::lock_guard<std::mutex> lock(doneMutex);
+		if(--running == 0) doneCond.notify_all();
+		return;
+	}
+	unsigned int delayMs = 50 + threadRandom().below(450); // runs on scheduler workers, so no rand()
+	game->deadline = Clock::now() + std::chrono::milliseconds(delayMs);
+	scheduler->postAfter(delayMs, [game]{
+		double late = std::chrono::duration<double, std::milli>(Clock::now() - game->deadline).count();
+		{
+			std::lock_guard<std::mutex> lock(doneMutex);
+			lateness.push_back(late);
+		}
+		nextRound(game);
+	});
+}
+
+int main(int argc, char** argv){
+	unsigned int games = (argc > 1 ? atoi(argv[1]) : 5000);
+	unsigned int rounds = (argc > 2 ? atoi(argv[2]) : 5);
+	std::ofstream file;
+	if(argc > 3){
+		file.open(argv[3]);
+		if(!file){
+			std::cerr << "Error: Could not open '" << argv[3] << "' for writing." << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& out = (argc > 3 ? file : std::cout);
+	if(games == 0 || rounds == 0){
+		std::cerr << "Error: GAMES and ROUNDS must be positive." << std::endl;
+		return 1;
+	}
+
+	Scheduler s;
+	scheduler = &s;
+	std::vector<SimGame> sims(games);
+	running = games;
+	auto start = Clock::now();
+	for(SimGame& game : sims){
+		game.roundsLeft = rounds;
+		s.post([&game]{ nextRound(&game); });
+	}
+	{
+		std::unique_lock<std::mutex> lock(doneMutex);
+		doneCond.wait(lock, []{ return running == 0; });
+	}
+	double wall = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::sort(lateness.begin(), lateness.end());
+	auto pct = [](double p){ return lateness[std::min(lateness.size() - 1, (size_t)(p * lateness.size()))]; };
+	out << "games,rounds,workers,timers,wall_s,late_p50_ms,late_p99_ms,late_max_ms" << std::endl;
+	out << games << "," << rounds << "," << s.getWorkerCount() << "," << lateness.size() << "," << wall << ",";
+	out << pct(0.5) << "," << pct(0.99) << "," << lateness.back() << std::endl;
+	return 0;
+}
@@ -0,0 +1,186 @@
+#include "../src/Words.h"
+#include "../src/WordIndex.h"
+#include "../src/Bitset.h"
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+// Measures the wordlist: loading it (text path and precompiled index), the scans the
+// scorer and the computer guesser do over it, and scoring a synthetic list of about a
+// million words (variants of the real ones), where the parallel scorer matters most, and
+// one bitset guess over the synthetic list's largest length buckets. Reports time, peak RSS and (on Linux, where
+// perf events are allowed) cache misses per phase as CSV. rss_kb is the resident set size
+// after the phase, so the difference between two rows is what that phase kept in memory.
+//
+// Usage: bin/WordlistBench [ITERATIONS] [OUTPUT.csv]   (run from the repository root)
+
+// Resident set size of the process, in kilobytes (the peak so far where the current one is not available).
+static long rssKb(){
+#ifdef __linux__
+	long pages = 0, resident = 0;
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if(statm){
+		int n = fscanf(statm, "%ld %ld", &pages, &resident);
+		fclose(statm);
+		if(n == 2) return resident * (sysconf(_SC_PAGESIZE) / 1024);
+	}
+#endif
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+	return usage.ru_maxrss;
+#endif
+}
+
+// Counts cache misses around a piece of code, where the kernel lets us (-1 otherwise).
+class MissCounter {
+	private:
+		int fd = -1;
+	public:
+		MissCounter(){
+#ifdef __linux__
+			struct perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = PERF_COUNT_HW_CACHE_MISSES;
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+		}
+		~MissCounter(){
+			if(fd >= 0) close(fd);
+		}
+		long long measure(std::function<void()> fn){
+#ifdef __linux__
+			if(fd >= 0){
+				ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+				fn();
+				ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+				long long count = 0;
+				if(read(fd, &count, sizeof(count)) == sizeof(count)) return count;
+				return -1;
+			}
+#endif
+			fn();
+			return -1;
+		}
+};
+
+// The inner loop of the computer guesser: filter the words of one length against a
+// pattern and count the letters of the survivors.
+static unsigned long long solverScan(Wordlist& list, unsigned int length){
+	unsigned long long counts[26] = {0};
+	const auto& words = list.getSortedWords();
+	for(const uint32_t* rank = list.ranksOfLengthBegin(length); rank != list.ranksOfLengthEnd(length); ++rank){
+		const auto& word = words[*rank];
+		if(word[0] == 'q' || word.find('j') != std::string::npos) continue; // some constraints
+		for(unsigned int i = 0; i < word.length(); i++) ++counts[(word[i] - 'a') % 26];
+	}
+	unsigned long long sum = 0;
+	for(unsigned long long c : counts) sum += c;
+	return sum;
+}
+
+// The same kind of query through the posting lists: 8 letters, 'a' first, 'r' fifth, no 'e'.
+static unsigned long long patternScan(Wordlist& list){
+	std::vector<uint32_t> matches;
+	list.matchPattern("a___r___", letterBit('e'), matches);
+	return matches.size();
+}
+
+// One computer guess with the bit rows: narrow the words of a length by a wrong letter, then
+// count every letter in every position of the survivors.
+static unsigned long long bitsetGuess(Wordlist& list, unsigned int length, const BitsetKernels& k){
+	std::vector<uint64_t> alive(list.getBitsetRowWords(length), ~0ULL); // padding bits are zero in every row, so they never count
+	k.andNotRow(alive.data(), list.wordsWithLetter(length, 'e'), alive.size());
+	unsigned long long sum = 0;
+	for(unsigned int i = 0; i < length; i++){
+		for(char c = 'a'; c <= 'z'; c++) sum += k.andCount(alive.data(), list.wordsWithLetterAt(length, i, c), alive.size());
+	}
+	return sum;
+}
+
+// The scorer's pass: read every letter of every word.
+static unsigned long long fullScan(Wordlist& list){
+	unsigned long long sum = 0;
+	for(const auto& word : list.getSortedWords()){
+		for(unsigned int i = 0; i < word.length(); i++) sum += (unsigned char)word[i];
+	}
+	return sum;
+}
+
+int main(int argc, char** argv){
+	unsigned int iterations = (argc > 1 ? atoi(argv[1]) : 20);
+	std::ofstream file;
+	if(argc > 2){
+		file.open(argv[2]);
+		if(!file){
+			std::cerr << "Error: Could not open '" << argv[2] << "' for writing." << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& out = (argc > 2 ? file : std::cout);
+	MissCounter misses;
+	std::vector<std::string> rows;
+	auto record = [&](const std::string& phase, unsigned int n, std::function<void()> fn){
+		auto start = std::chrono::steady_clock::now();
+		long long missCount = misses.measure([&]{ for(unsigned int i = 0; i < n; i++) fn(); });
+		double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / n;
+		std::stringstream row;
+		row << phase << "," << n << "," << us << "," << rssKb() << "," << (missCount < 0 ? missCount : missCount / n);
+		rows.push_back(row.str());
+	};
+
+	long baseRss = rssKb();
+	Wordlist text;
+	record("load_text", 1, [&]{
+		if(!text.readWordlist(WORDLIST_PATH)){
+			std::cerr << "Error: Could not open wordlist." << std::endl;
+			std::exit(1);
+		}
+		text.scoreWords();
+	});
+	unsigned long long sink = 0;
+	record("full_scan", iterations, [&]{ sink += fullScan(text); });
+	record("solver_scan", iterations, [&]{ sink += solverScan(text, 8); });
+	record("pattern_scan", iterations, [&]{ sink += patternScan(text); });
+	for(BitsetIsa isa : {BITSET_SCALAR, BITSET_AVX2}){
+		if(!bitsetSupported(isa)) continue;
+		const BitsetKernels& k = bitsetKernels(isa);
+		record(std::string("bitset_guess_") + k.name, iterations, [&]{ sink += bitsetGuess(text, 8, k); });
+	}
+
+	Wordlist indexed;
+	record("load_index", 1, [&]{
+		if(!indexed.loadIndex(WORDLIST_INDEX_PATH, WORDLIST_PATH)) std::cerr << "Warning: No usable index; run 'make wordlist.idx'." << std::endl;
+	});
+
+	// Last, since it grows the process by far more than the real list does.
+	std::stringstream generated;
+	for(unsigned int i = 0; generated.tellp() < 12 * 1000 * 1000; i++){
+		const auto& word = text.getSortedWords()[i % text.getSortedWords().size()];
+		generated << word << (char)('a' + (i / 7) % 26) << (char)('a' + (i / 191) % 26) << "\n";
+	}
+	Wordlist synthetic;
+	synthetic.readWordlist(generated);
+	record("score_synthetic", 1, [&]{ synthetic.scoreWords(); });
+	record("bitset_guess_synthetic", iterations, [&]{ sink += bitsetGuess(synthetic, 10, bitsetKernels()); });
+
+	out << "phase,iterations,us,rss_kb,cache_misses" << std::endl;
+	out << "baseline,0,0," << baseRss << ",-1" << std::endl;
+	for(const std::string& row : rows) out << row << std::endl;
+	return (sink == 42 ? 1 : 0); // keep the scans from being optimized away
+}
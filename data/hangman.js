@@ -1,3 +1,10 @@
+// Prefix for requests to this page's room ("" for the default room, "/room/<id>" otherwise).
+var ROOM_PREFIX = (window.location.pathname.match(/^\/room\/[A-Za-z0-9_-]+/) || [""])[0];
+
+function roomUrl(path){
+	return ROOM_PREFIX + path;
+}
+
 function isMobile(){
 	return (/Android|webOS|iPhone|iPad|iPod|BlackBerry|IEMobile|Opera Mini/i.test(navigator.userAgent));
 }
@@ -19,14 +26,20 @@ function displayAlert(title, body, alert_context_class, fade_timeout){
 	alert.delay(fade_timeout).fadeOut("slow", function(){ $(this).remove(); });
 }
 
+var WARMING_UP_RETRY_MS = 1000;
+var warmingUp = false; // the server answered, but the game is still loading
+var warmingRetry = null;
+
 function reloadWord(){
 	// Get the word.
 	var success = false;
 	$.ajax({
 		type: "GET",
-		url: "/getBlankedWord",
+		url: roomUrl("/getBlankedWord"),
 		async: false
 	}).done(function(data){
+		warmingUp = (data["warmingUp"] == true);
+		if(warmingUp) return;
 		success = true;
 		$('#blanked').text(data["blanked"]);
 		$('.blanked-word-header').text("Word (" + data["length"] + " letters)");
@@ -43,7 +56,7 @@ function reloadTable(){
 	var success = false;
 	$.ajax({
 		type: "GET",
-		url: "/getGameInfo",
+		url: roomUrl("/getGameInfo"),
 		async: false
 	}).done(function(data){
 		console.log(data);
@@ -95,7 +108,7 @@ function reloadAlerts(){
 	var success = false;
 	$.ajax({
 		type: "GET",
-		url: "/getLatestAlert",
+		url: roomUrl("/getLatestAlert"),
 		async: false
 	}).done(function(data){
 		success = true;
@@ -137,7 +150,7 @@ function reloadAlerts(){
 									data_map[args[2]] = $('#promptGenWord').val();
 									$.ajax({
 										type: "GET",
-										url: args[1],
+										url: roomUrl(args[1]),
 										data: data_map,
 										async: false
 									}).done(function(data){
@@ -171,7 +184,7 @@ function reloadAlerts(){
 									$(this).click(function() {
 										$.ajax({
 											type: "GET",
-											url: args[1],
+											url: roomUrl(args[1]),
 											data: data_map,
 											async: false
 										}).done(function(data){
@@ -196,7 +209,7 @@ function reloadAlerts(){
 							// Fill in the word form.
 							$.ajax({
 								type: "GET",
-								url: "/getWordFillForm",
+								url: roomUrl("/getWordFillForm"),
 								async: false
 							}).done(function(data){
 								$('#promptGeneralWordFill').html(data);
@@ -217,7 +230,7 @@ function reloadAlerts(){
 									data_map[args[2]] = dataVal;
 									$.ajax({
 										type: "GET",
-										url: args[1],
+										url: roomUrl(args[1]),
 										data: data_map,
 										async: false
 									}).done(function(data){
@@ -255,7 +268,7 @@ function reloadPercentage(){
 	var success = false;
 	$.ajax({
 		type: "GET",
-		url: "/guessPercentage",
+		url: roomUrl("/guessPercentage"),
 		async: false
 	}).done(function(data){
 		success = true;
@@ -285,7 +298,7 @@ function reloadLetters(){
 	var letters;
 	$.ajax({
 		type: "GET",
-		url: "/getExtantLetters",
+		url: roomUrl("/getExtantLetters"),
 		async: false
 	}).done(function(data){
 		success = true;
@@ -320,6 +333,19 @@ function reloadInterface(){
 		    reloadPercentage() &&
 		    reloadLetters()    &&
 		    reloadAlerts(); // all will have to be evaluated until the first one fails (e.g. returns undefined/false)
+	if(warmingUp){
+		// Connected, but the game has not loaded yet: say so, and check again soon.
+		$('#disconnected_panel').hide();
+		$('#warming_panel').show();
+		if(warmingRetry === null){
+			warmingRetry = setTimeout(function(){
+				warmingRetry = null;
+				reloadInterface();
+			}, WARMING_UP_RETRY_MS);
+		}
+		return;
+	}
+	$('#warming_panel').hide();
 	if(!success){
 		console.log("Disconnected!");
 		$('#disconnected_panel').show();
@@ -331,7 +357,7 @@ function reloadInterface(){
 function guessLetter(letter){
 	$.ajax({
 		type: "GET",
-		url: "/guessLetter",
+		url: roomUrl("/guessLetter"),
 		data: {'letter': letter},
 		async: false
 	}).done(function(data){
@@ -367,7 +393,7 @@ $(document).ready(function() {
 		var ret = false;
 		$.ajax({
 			type: "GET",
-			url: "/chooseWord",
+			url: roomUrl("/chooseWord"),
 			data: {'word': $('#promptword').val()},
 			async: false
 		}).done(function(data){
@@ -0,0 +1,166 @@
+#include "Assets.h"
+#include "Blit.h"
+#include "Startup.h"
+#include "WordIndex.h"
+#include <future>
+#include <thread>
+#include <sys/stat.h>
+
+// Load a PNG as a truecolor image with its alpha channel intact, so the blit kernels can use it.
+static gdImagePtr loadTrueColorPng(const std::string& path){
+	FILE* in = fopen(path.c_str(), "rb");
+	if(!in) return NULL;
+	gdImagePtr img = gdImageCreateFromPng(in);
+	fclose(in);
+	if(!img) return NULL;
+	gdImagePtr ret = gdImageCreateTrueColor(img->sx, img->sy);
+	gdImageAlphaBlending(ret, 0);
+	gdImageSaveAlpha(ret, 1);
+	fillRect(ret, 0, 0, ret->sx - 1, ret->sy - 1, gdAlphaMax << 24); // transparent, for palette images with a transparent index
+	gdImageCopy(ret, img, 0, 0, 0, 0, img->sx, img->sy);
+	gdImageDestroy(img);
+	return ret;
+}
+
+std::shared_ptr<Wordlist> GameAssets::buildWordlist(){
+	// Map the precompiled index if it is up to date; otherwise parse and score the text wordlist.
+	std::shared_ptr<Wordlist> built = std::make_shared<Wordlist>();
+	if(!built->loadIndex(WORDLIST_INDEX_PATH, WORDLIST_PATH)){
+		if(!built->readWordlist(WORDLIST_PATH)) return nullptr;
+		built->scoreWords();
+	}
+	return built;
+}
+
+std::string GameAssets::wordlistStamp(){
+	std::stringstream stamp;
+	for(const std::string& path : {WORDLIST_PATH, WORDLIST_INDEX_PATH}){
+		struct stat st;
+		if(stat(path.c_str(), &st) == 0) stamp << st.st_size << ":" << st.st_mtime << "|";
+		else stamp << "-|";
+	}
+	return stamp.str();
+}
+
+void GameAssets::loadWordlist(){
+	std::string stamp = wordlistStamp();
+	std::shared_ptr<Wordlist> built = buildWordlist();
+	if(!built){
+		std::cerr << "Error: Could not open wordlist." << std::endl;
+		std::exit(1);
+	}
+	reloadMutex.lock();
+	listStamp = stamp;
+	reloadMutex.unlock();
+	std::atomic_store(&list, std::shared_ptr<const Wordlist>(built));
+	startupMilestone("wordlist ready");
+}
+
+void GameAssets::loadImages(){
+	// Initialize background image.
+	background = loadTrueColorPng("background.png");
+	if(!background){
+		std::cerr << "Error: Could not open 'background.png' for reading background." << std::endl;
+		std::exit(1);
+	}
+	frames.reset(new FramePool(background->sx, background->sy));
+
+	// Decode the hangman stages once, instead of on every frame.
+	for(unsigned int i = 0; i <= GUESS_LIMIT; i++){
+		std::stringstream stage_file;
+		stage_file << "data/stage" << (i + 1) << ".png";
+		stages[i] = loadTrueColorPng(stage_file.str());
+		if(!stages[i]){
+			std::cerr << "Error: Could not open '" << stage_file.str() << "' for reading hangman stage." << std::endl;
+			std::exit(1);
+		}
+	}
+	startupMilestone("images ready");
+}
+
+void GameAssets::loadAll(){
+	// The wordlist and the images do not depend on each other, so load them concurrently.
+	auto words = std::async(std::launch::async, &GameAssets::loadWordlist, this);
+	auto images = std::async(std::launch::async, &GameAssets::loadImages, this);
+	words.get();
+	images.get();
+	ready = true;
+	startupMilestone("game ready");
+}
+
+void GameAssets::load(){
+	std::call_once(loadOnce, &GameAssets::loadAll, this);
+}
+
+void GameAssets::loadInBackground(){
+	if(ready || loadStarted.exchange(true)) return;
+	std::thread(&GameAssets::load, this).detach();
+}
+
+bool GameAssets::reloadWordlist(){
+	if(!ready || reloading.exchange(true)) return false;
+	std::thread(&GameAssets::runReload, this).detach();
+	return true;
+}
+
+void GameAssets::runReload(){
+	// Build the new list here, off the game and request threads; the swap is a single store.
+	auto start = std::chrono::steady_clock::now();
+	std::string stamp = wordlistStamp();
+	std::shared_ptr<Wordlist> built = buildWordlist();
+	if(!built){
+		std::cerr << "Warning: Could not reload the wordlist; keeping the current one." << std::endl;
+	} else {
+		std::shared_ptr<const Wordlist> old = std::atomic_exchange(&list, std::shared_ptr<const Wordlist>(built));
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "Reloaded the wordlist (" << built->getSortedWords().size() << " words, " << ms << " ms)." << std::endl;
+		std::lock_guard<std::mutex> lock(reloadMutex);
+		listStamp = stamp;
+		retired.push_back(old);
+	}
+	reloading = false; // the next reload may start while this thread sweeps
+
+	// Become the sweeper, unless another reload thread already is.
+	reloadMutex.lock();
+	bool sweep = !sweeping && !retired.empty();
+	if(sweep) sweeping = true;
+	reloadMutex.unlock();
+	if(sweep) sweepRetired();
+}
+
+void GameAssets::sweepRetired(){
+	// Free the lists that rounds have stopped using, checking again every RETIRED_SWEEP_MS
+	// while any is still in use. Holding them here means the last reference is never
+	// dropped, and a whole list freed, on a game or request thread.
+	while(true){
+		std::vector<std::shared_ptr<const Wordlist> > unused;
+		reloadMutex.lock();
+		for(auto it = retired.begin(); it != retired.end();){
+			if(it->use_count() == 1){
+				unused.push_back(std::move(*it));
+				it = retired.erase(it);
+			} else {
+				++it;
+			}
+		}
+		bool done = retired.empty();
+		if(done) sweeping = false; // under the lock, so a list retired after this starts a new sweeper
+		reloadMutex.unlock();
+		unused.clear();
+		if(done) return;
+		std::this_thread::sleep_for(std::chrono::milliseconds(RETIRED_SWEEP_MS));
+	}
+}
+
+void GameAssets::watchWordlist(Scheduler& scheduler, unsigned int intervalMs){
+	scheduler.postAfter(intervalMs, [this, &scheduler, intervalMs]{
+		if(ready){
+			std::string stamp = wordlistStamp();
+			reloadMutex.lock();
+			bool changed = (stamp != listStamp);
+			reloadMutex.unlock();
+			if(changed) reloadWordlist();
+		}
+		watchWordlist(scheduler, intervalMs);
+	});
+}
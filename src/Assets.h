@@ -0,0 +1,58 @@
+#ifndef ASSETS_INC
+#define ASSETS_INC
+#include "Words.h"
+#include "FrameCache.h"
+#include "FramePool.h"
+#include "Scheduler.h"
+#include <gd.h>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+
+#define SHARED_FRAME_CACHE_SIZE 64 // encoded frames kept for all rooms together
+#define RETIRED_SWEEP_MS 1000 // how often replaced wordlists are checked for rounds still using them
+
+// Read-only data shared by every game (room) in the process: the scored wordlist, the
+// decoded images, and the pools/caches used to render frames. Loaded once, except for the
+// wordlist, which can be rebuilt while the server runs: a new immutable Wordlist is built
+// on a background thread and swapped in with one atomic store. Games take the current one
+// at the start of each round and keep it until the round ends, so a reload never changes
+// the words under a round in progress and never makes anyone wait.
+class GameAssets {
+	private:
+		std::once_flag loadOnce;
+		std::atomic<bool> loadStarted{false}; // loadInBackground has started a loading thread
+		std::atomic<bool> ready{false};
+		std::shared_ptr<const Wordlist> list; // current wordlist; use atomic_load/atomic_store only (a hashed lock, as for Game::published)
+		std::atomic<bool> reloading{false}; // a reload thread is running
+		std::mutex reloadMutex; // protects listStamp, retired and sweeping
+		std::string listStamp; // size and modification time of the files the current wordlist came from
+		std::vector<std::shared_ptr<const Wordlist> > retired; // replaced wordlists, freed by the sweeper once no game uses them
+		bool sweeping = false; // a reload thread is sweeping retired
+
+		static std::shared_ptr<Wordlist> buildWordlist(); // map the index or read and score the text; nullptr on failure
+		static std::string wordlistStamp(); // see listStamp
+		void loadWordlist(); // read and score the wordlist
+		void loadImages(); // decode the background and hangman stages
+		void loadAll(); // both, concurrently
+		void runReload(); // body of the reload thread
+		void sweepRetired(); // free retired wordlists as their last rounds end, until none are left
+	public:
+		gdImagePtr background = NULL; // background image
+		gdImagePtr stages[GUESS_LIMIT + 1]; // decoded hangman stage images, by number of incorrect guesses
+		std::unique_ptr<FramePool> frames; // reusable framebuffers
+		FrameCache frameCache{SHARED_FRAME_CACHE_SIZE}; // recently encoded frames, keyed by their render inputs
+
+		GameAssets(){ }
+		~GameAssets(){ }
+
+		void load(); // load everything (once; concurrent callers wait for the first)
+		void loadInBackground(); // start load() on its own thread, if nothing has yet; never waits
+		bool isReady(){ return ready; } // whether load() has finished
+		std::shared_ptr<const Wordlist> getWordlist(){ return std::atomic_load(&list); } // current wordlist
+		bool reloadWordlist(); // rebuild the wordlist in the background and swap it in; false if not loaded yet or already reloading
+		void watchWordlist(Scheduler& scheduler, unsigned int intervalMs); // reload whenever the wordlist files change
+};
+
+#endif
@@ -0,0 +1,83 @@
+#include "Bitset.h"
+#if defined(__x86_64__) || defined(__i386__)
+#define BITSET_X86 1
+#include <immintrin.h>
+#endif
+
+// Scalar kernels. //
+static void andRowScalar(uint64_t* dst, const uint64_t* src, size_t n){
+	for(size_t i = 0; i < n; i++) dst[i] &= src[i];
+}
+
+static void andNotRowScalar(uint64_t* dst, const uint64_t* src, size_t n){
+	for(size_t i = 0; i < n; i++) dst[i] &= ~src[i];
+}
+
+static uint64_t andCountScalar(const uint64_t* a, const uint64_t* b, size_t n){
+	uint64_t count = 0;
+	for(size_t i = 0; i < n; i++) count += (uint64_t)__builtin_popcountll(a[i] & b[i]);
+	return count;
+}
+
+#ifdef BITSET_X86
+// AVX2 kernels (256 bits at a time). //
+__attribute__((target("avx2")))
+static void andRowAVX2(uint64_t* dst, const uint64_t* src, size_t n){
+	for(size_t i = 0; i < n; i += 4){
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_and_si256(d, _mm256_loadu_si256((const __m256i*)(src + i))));
+	}
+}
+
+__attribute__((target("avx2")))
+static void andNotRowAVX2(uint64_t* dst, const uint64_t* src, size_t n){
+	for(size_t i = 0; i < n; i += 4){
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_andnot_si256(_mm256_loadu_si256((const __m256i*)(src + i)), d));
+	}
+}
+
+__attribute__((target("avx2")))
+static uint64_t andCountAVX2(const uint64_t* a, const uint64_t* b, size_t n){
+	// AVX2 has no vector popcount: look up the count of each nibble with a byte shuffle,
+	// then sum the bytes of each 64-bit lane with SAD against zero.
+	const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i nibble = _mm256_set1_epi8(0x0F);
+	__m256i total = _mm256_setzero_si256();
+	for(size_t i = 0; i < n; i += 4){
+		__m256i x = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+		__m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(x, nibble));
+		__m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+		total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+	}
+	alignas(32) uint64_t lanes[4];
+	_mm256_store_si256((__m256i*)lanes, total);
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+#endif
+
+static const BitsetKernels KERNELS[] = {
+	{"scalar", andRowScalar, andNotRowScalar, andCountScalar},
+#ifdef BITSET_X86
+	{"avx2", andRowAVX2, andNotRowAVX2, andCountAVX2},
+#endif
+};
+
+bool bitsetSupported(BitsetIsa isa){
+	switch(isa){
+		case BITSET_SCALAR: return true;
+#ifdef BITSET_X86
+		case BITSET_AVX2: return __builtin_cpu_supports("avx2");
+#endif
+		default: return false;
+	}
+}
+
+const BitsetKernels& bitsetKernels(BitsetIsa isa){
+	return KERNELS[bitsetSupported(isa) ? isa : BITSET_SCALAR];
+}
+
+const BitsetKernels& bitsetKernels(){
+	static const BitsetKernels& best = bitsetKernels(BITSET_AVX2);
+	return best;
+}
@@ -0,0 +1,36 @@
+#ifndef BITSET_INC
+#define BITSET_INC
+#include <cstdint>
+#include <cstddef>
+
+// Kernels over packed bit vectors (rows of uint64_t, bit j of a row is bit j % 64 of word
+// j / 64), used to filter and count candidate words a whole row at a time.
+//
+// Each kernel has a scalar version and, on x86, an AVX2 version; the best one supported by
+// the CPU is picked at runtime. All versions produce identical results. Rows handed to
+// the kernels are padded to a multiple of BITSET_ROW_WORDS words, so no kernel needs a tail.
+
+#define BITSET_ROW_WORDS 4 // 256 bits, one AVX2 register
+
+enum BitsetIsa {
+	BITSET_SCALAR = 0,
+	BITSET_AVX2
+};
+
+struct BitsetKernels {
+	const char* name;
+	void (*andRow)(uint64_t* dst, const uint64_t* src, size_t n); // dst &= src
+	void (*andNotRow)(uint64_t* dst, const uint64_t* src, size_t n); // dst &= ~src
+	uint64_t (*andCount)(const uint64_t* a, const uint64_t* b, size_t n); // bits set in a & b
+};
+
+// Words in a row of the given number of bits, padded to BITSET_ROW_WORDS.
+inline size_t bitsetRowWords(size_t bits){
+	return (bits + 64 * BITSET_ROW_WORDS - 1) / (64 * BITSET_ROW_WORDS) * BITSET_ROW_WORDS;
+}
+
+bool bitsetSupported(BitsetIsa isa); // whether this CPU can run the given kernels
+const BitsetKernels& bitsetKernels(BitsetIsa isa); // kernels for a specific ISA (must be supported)
+const BitsetKernels& bitsetKernels(); // best kernels for this CPU
+
+#endif
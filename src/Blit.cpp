@@ -0,0 +1,194 @@
+#include "Blit.h"
+#include <algorithm>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#define BLIT_X86 1
+#include <immintrin.h>
+#endif
+
+// Blending: c = (src * (127 - a) + dst * a + 63) / 127 per channel, where a is the source
+// alpha. The division is done as (x * 33027) >> 22, which is exact for every x that can occur.
+static inline int blendChannel(int s, int d, int a){
+	unsigned int x = (unsigned int)(s * (gdAlphaMax - a) + d * a + 63);
+	return (int)((x * 33027U) >> 22);
+}
+
+// Scalar kernels. //
+static void copyRowScalar(int* dst, const int* src, int n){
+	std::memcpy(dst, src, n * sizeof(int));
+}
+
+static void blendRowScalar(int* dst, const int* src, int n){
+	for(int i = 0; i < n; i++){
+		int s = src[i], d = dst[i];
+		int a = gdTrueColorGetAlpha(s);
+		int r = blendChannel(gdTrueColorGetRed(s), gdTrueColorGetRed(d), a);
+		int g = blendChannel(gdTrueColorGetGreen(s), gdTrueColorGetGreen(d), a);
+		int b = blendChannel(gdTrueColorGetBlue(s), gdTrueColorGetBlue(d), a);
+		dst[i] = (r << 16) | (g << 8) | b;
+	}
+}
+
+static void fillRowScalar(int* dst, int color, int n){
+	std::fill(dst, dst + n, color);
+}
+
+#ifdef BLIT_X86
+// SSE2 kernels (4 pixels at a time). //
+__attribute__((target("sse2")))
+static void copyRowSSE2(int* dst, const int* src, int n){
+	int i = 0;
+	for(; i + 4 <= n; i += 4){
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_loadu_si128((const __m128i*)(src + i)));
+	}
+	for(; i < n; i++) dst[i] = src[i];
+}
+
+__attribute__((target("sse2")))
+static inline __m128i blendHalfSSE2(__m128i s, __m128i d){
+	// s and d hold two pixels as 16-bit b, g, r, a lanes.
+	const __m128i max = _mm_set1_epi16(gdAlphaMax);
+	__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m128i x = _mm_add_epi16(_mm_mullo_epi16(s, _mm_sub_epi16(max, a)), _mm_mullo_epi16(d, a));
+	x = _mm_add_epi16(x, _mm_set1_epi16(63));
+	return _mm_srli_epi16(_mm_mulhi_epu16(x, _mm_set1_epi16((short)33027)), 6);
+}
+
+__attribute__((target("sse2")))
+static void blendRowSSE2(int* dst, const int* src, int n){
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+	int i = 0;
+	for(; i + 4 <= n; i += 4){
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+		__m128i lo = blendHalfSSE2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+		__m128i hi = blendHalfSSE2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_and_si128(_mm_packus_epi16(lo, hi), rgb));
+	}
+	blendRowScalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static void fillRowSSE2(int* dst, int color, int n){
+	const __m128i c = _mm_set1_epi32(color);
+	int i = 0;
+	for(; i + 4 <= n; i += 4){
+		_mm_storeu_si128((__m128i*)(dst + i), c);
+	}
+	for(; i < n; i++) dst[i] = color;
+}
+
+// AVX2 kernels (8 pixels at a time). //
+__attribute__((target("avx2")))
+static void copyRowAVX2(int* dst, const int* src, int n){
+	int i = 0;
+	for(; i + 8 <= n; i += 8){
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_loadu_si256((const __m256i*)(src + i)));
+	}
+	copyRowSSE2(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blendHalfAVX2(__m256i s, __m256i d){
+	const __m256i max = _mm256_set1_epi16(gdAlphaMax);
+	__m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m256i x = _mm256_add_epi16(_mm256_mullo_epi16(s, _mm256_sub_epi16(max, a)), _mm256_mullo_epi16(d, a));
+	x = _mm256_add_epi16(x, _mm256_set1_epi16(63));
+	return _mm256_srli_epi16(_mm256_mulhi_epu16(x, _mm256_set1_epi16((short)33027)), 6);
+}
+
+__attribute__((target("avx2")))
+static void blendRowAVX2(int* dst, const int* src, int n){
+	// Unpacking and packing both work within 128-bit lanes, so pixel order is preserved.
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i rgb = _mm256_set1_epi32(0x00FFFFFF);
+	int i = 0;
+	for(; i + 8 <= n; i += 8){
+		__m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+		__m256i lo = blendHalfAVX2(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+		__m256i hi = blendHalfAVX2(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_and_si256(_mm256_packus_epi16(lo, hi), rgb));
+	}
+	blendRowSSE2(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void fillRowAVX2(int* dst, int color, int n){
+	const __m256i c = _mm256_set1_epi32(color);
+	int i = 0;
+	for(; i + 8 <= n; i += 8){
+		_mm256_storeu_si256((__m256i*)(dst + i), c);
+	}
+	fillRowSSE2(dst + i, color, n - i);
+}
+#endif
+
+static const BlitKernels KERNELS[] = {
+	{"scalar", copyRowScalar, blendRowScalar, fillRowScalar},
+#ifdef BLIT_X86
+	{"sse2", copyRowSSE2, blendRowSSE2, fillRowSSE2},
+	{"avx2", copyRowAVX2, blendRowAVX2, fillRowAVX2},
+#endif
+};
+
+bool blitSupported(BlitIsa isa){
+	switch(isa){
+		case BLIT_SCALAR: return true;
+#ifdef BLIT_X86
+		case BLIT_SSE2: return __builtin_cpu_supports("sse2");
+		case BLIT_AVX2: return __builtin_cpu_supports("avx2");
+#endif
+		default: return false;
+	}
+}
+
+const BlitKernels& blitKernels(BlitIsa isa){
+	return KERNELS[blitSupported(isa) ? isa : BLIT_SCALAR];
+}
+
+const BlitKernels& blitKernels(){
+	static const BlitKernels& best = (blitSupported(BLIT_AVX2) ? blitKernels(BLIT_AVX2) : blitKernels(BLIT_SSE2));
+	return best;
+}
+
+// Clip the rectangle of src placed at (dx, dy) against dst; returns false if nothing is visible.
+static bool clipBlit(gdImagePtr dst, gdImagePtr src, int& dx, int& dy, int& sx, int& sy, int& w, int& h){
+	sx = std::max(0, -dx);
+	sy = std::max(0, -dy);
+	dx = std::max(0, dx);
+	dy = std::max(0, dy);
+	w = std::min(src->sx - sx, dst->sx - dx);
+	h = std::min(src->sy - sy, dst->sy - dy);
+	return w > 0 && h > 0;
+}
+
+void blitOpaque(gdImagePtr dst, gdImagePtr src, int dx, int dy, const BlitKernels& k){
+	int sx, sy, w, h;
+	if(!clipBlit(dst, src, dx, dy, sx, sy, w, h)) return;
+	for(int y = 0; y < h; y++){
+		k.copyRow(dst->tpixels[dy + y] + dx, src->tpixels[sy + y] + sx, w);
+	}
+}
+
+void blitAlpha(gdImagePtr dst, gdImagePtr src, int dx, int dy, const BlitKernels& k){
+	int sx, sy, w, h;
+	if(!clipBlit(dst, src, dx, dy, sx, sy, w, h)) return;
+	for(int y = 0; y < h; y++){
+		k.blendRow(dst->tpixels[dy + y] + dx, src->tpixels[sy + y] + sx, w);
+	}
+}
+
+void fillRect(gdImagePtr dst, int x1, int y1, int x2, int y2, int color, const BlitKernels& k){
+	if(x1 > x2) std::swap(x1, x2);
+	if(y1 > y2) std::swap(y1, y2);
+	x1 = std::max(0, x1);
+	y1 = std::max(0, y1);
+	x2 = std::min(dst->sx - 1, x2);
+	y2 = std::min(dst->sy - 1, y2);
+	if(x2 < x1 || y2 < y1) return;
+	for(int y = y1; y <= y2; y++){
+		k.fillRow(dst->tpixels[y] + x1, color, x2 - x1 + 1);
+	}
+}
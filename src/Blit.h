@@ -0,0 +1,34 @@
+#ifndef BLIT_INC
+#define BLIT_INC
+#include <gd.h>
+
+// Compositing kernels for our framebuffers: gd truecolor images, one int per pixel
+// (7-bit alpha where 0 = opaque, then 8-bit red, green and blue). The destination
+// framebuffer is always treated as opaque, so blending never needs its alpha.
+//
+// Each kernel has a scalar version and, on x86, SSE2 and AVX2 versions; the best one
+// supported by the CPU is picked at runtime. All versions produce identical output.
+
+enum BlitIsa {
+	BLIT_SCALAR = 0,
+	BLIT_SSE2,
+	BLIT_AVX2
+};
+
+struct BlitKernels {
+	const char* name;
+	void (*copyRow)(int* dst, const int* src, int n); // dst = src
+	void (*blendRow)(int* dst, const int* src, int n); // dst = src over dst (opaque result)
+	void (*fillRow)(int* dst, int color, int n); // dst = color
+};
+
+bool blitSupported(BlitIsa isa); // whether this CPU can run the given kernels
+const BlitKernels& blitKernels(BlitIsa isa); // kernels for a specific ISA (must be supported)
+const BlitKernels& blitKernels(); // best kernels for this CPU
+
+// Image-level operations, clipped to the destination. Both images must be truecolor.
+void blitOpaque(gdImagePtr dst, gdImagePtr src, int dx, int dy, const BlitKernels& k = blitKernels()); // copy src to (dx, dy)
+void blitAlpha(gdImagePtr dst, gdImagePtr src, int dx, int dy, const BlitKernels& k = blitKernels()); // blend src onto (dx, dy)
+void fillRect(gdImagePtr dst, int x1, int y1, int x2, int y2, int color, const BlitKernels& k = blitKernels()); // corners inclusive
+
+#endif
@@ -0,0 +1,140 @@
+#include "Broadcast.h"
+#include <algorithm>
+
+DeviceSender::DeviceSender(std::string n, std::unique_ptr<FrameSink> s) : name(n), sink(std::move(s)) {
+	retryAt = std::chrono::steady_clock::now();
+}
+
+std::shared_ptr<DeviceSender> DeviceSender::start(std::string name, std::unique_ptr<FrameSink> sink){
+	std::shared_ptr<DeviceSender> sender = std::make_shared<DeviceSender>(name, std::move(sink));
+	std::thread(&DeviceSender::run, sender).detach();
+	return sender;
+}
+
+void DeviceSender::stop(){
+	{
+		std::lock_guard<std::mutex> guard(senderMutex);
+		stopping = true;
+	}
+	wakeup.notify_all();
+}
+
+void DeviceSender::enqueue(std::shared_ptr<const std::string> frame){
+	{
+		std::lock_guard<std::mutex> guard(senderMutex);
+		if(dead || stopping) return;
+		queue.push_back(frame);
+		while(queue.size() > SENDER_QUEUE_LIMIT){
+			queue.pop_front(); // only the newest frames matter
+			++dropped;
+		}
+	}
+	wakeup.notify_one();
+}
+
+bool DeviceSender::isDead(){
+	std::lock_guard<std::mutex> guard(senderMutex);
+	if(sending && std::chrono::steady_clock::now() - sendStarted > std::chrono::milliseconds(SENDER_STALL_MS)){
+		std::cerr << "Warning: Device '" << name << "' stalled, dropping it." << std::endl;
+		dead = true;
+	}
+	return dead;
+}
+
+void DeviceSender::run(std::shared_ptr<DeviceSender> self){
+	std::unique_lock<std::mutex> lock(self->senderMutex);
+	while(true){
+		// Wait for a frame and for any backoff to expire.
+		self->wakeup.wait(lock, [&]{ return self->stopping || !self->queue.empty(); });
+		if(self->stopping) break;
+		if(std::chrono::steady_clock::now() < self->retryAt){
+			self->wakeup.wait_until(lock, self->retryAt, [&]{ return self->stopping; });
+			continue;
+		}
+
+		// Send the oldest queued frame without holding the lock.
+		std::shared_ptr<const std::string> frame = self->queue.front();
+		self->queue.pop_front();
+		self->sending = true;
+		self->sendStarted = std::chrono::steady_clock::now();
+		lock.unlock();
+		bool ok = false;
+		try {
+			ok = self->sink->send(*frame);
+		} catch(...){
+			ok = false;
+		}
+		lock.lock();
+		self->sending = false;
+
+		// Back off exponentially on failure, giving up after too many in a row.
+		if(ok){
+			self->failures = 0;
+			++self->sent;
+		} else if(++self->failures >= SENDER_MAX_FAILURES){
+			std::cerr << "Warning: Device '" << self->name << "' failed " << self->failures << " times, dropping it." << std::endl;
+			self->dead = true;
+			break;
+		} else {
+			long delay = std::min((long)SENDER_MAX_BACKOFF_MS, (long)SENDER_BACKOFF_MS << (self->failures - 1));
+			self->retryAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay);
+		}
+	}
+	self->queue.clear();
+}
+
+BroadcastSink::~BroadcastSink(){
+	std::lock_guard<std::mutex> guard(devicesMutex);
+	for(auto& device : devices) device->stop();
+}
+
+void BroadcastSink::addDevice(std::string name, std::unique_ptr<FrameSink> sink){
+	std::lock_guard<std::mutex> guard(devicesMutex);
+	devices.push_back(DeviceSender::start(name, std::move(sink)));
+	if(lastFrame) devices.back()->enqueue(lastFrame);
+	std::cerr << "Broadcasting to '" << name << "' (" << devices.size() << " device(s))." << std::endl;
+}
+
+bool BroadcastSink::hasDevice(const std::string& name){
+	std::lock_guard<std::mutex> guard(devicesMutex);
+	for(auto& device : devices){
+		if(device->getName() == name) return true;
+	}
+	return false;
+}
+
+size_t BroadcastSink::getDeviceCount(){
+	std::lock_guard<std::mutex> guard(devicesMutex);
+	return devices.size();
+}
+
+bool BroadcastSink::send(const std::string& frame){
+	return sendShared(std::make_shared<const std::string>(frame));
+}
+
+void BroadcastSink::pruneLocked(){
+	// Drop dead devices; their threads exit on their own.
+	for(auto it = devices.begin(); it != devices.end();){
+		if((*it)->isDead()){
+			(*it)->stop();
+			it = devices.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void BroadcastSink::prune(){
+	std::lock_guard<std::mutex> guard(devicesMutex);
+	pruneLocked();
+}
+
+bool BroadcastSink::sendShared(std::shared_ptr<const std::string> frame){
+	std::lock_guard<std::mutex> guard(devicesMutex);
+	pruneLocked();
+
+	// Queue the same frame on every device.
+	lastFrame = frame;
+	for(auto& device : devices) device->enqueue(frame);
+	return true;
+}
@@ -0,0 +1,67 @@
+#ifndef BROADCAST_INC
+#define BROADCAST_INC
+#include "Sink.h"
+#include <memory>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+#define SENDER_QUEUE_LIMIT 2 // frames queued per device before the oldest is dropped
+#define SENDER_MAX_FAILURES 6 // consecutive failures before a device is dropped
+#define SENDER_BACKOFF_MS 250 // first retry delay, doubled on each failure
+#define SENDER_MAX_BACKOFF_MS 8000
+#define SENDER_STALL_MS 10000 // a single send taking longer than this drops the device
+
+// Delivers frames to one device from its own thread, through a small bounded queue,
+// so a slow or unreachable device never holds up the others.
+class DeviceSender {
+	private:
+		const std::string name;
+		std::unique_ptr<FrameSink> sink;
+
+		std::mutex senderMutex; // protects everything below
+		std::condition_variable wakeup;
+		std::deque<std::shared_ptr<const std::string> > queue; // newest at the back
+		unsigned int failures = 0; // consecutive failed sends
+		std::chrono::steady_clock::time_point retryAt; // no sends before this (backoff)
+		std::chrono::steady_clock::time_point sendStarted; // start of the send in progress
+		bool sending = false;
+		bool stopping = false;
+		bool dead = false;
+		unsigned long long sent = 0, dropped = 0;
+
+		static void run(std::shared_ptr<DeviceSender> self); // sender thread body
+	public:
+		DeviceSender(std::string name, std::unique_ptr<FrameSink> sink);
+
+		static std::shared_ptr<DeviceSender> start(std::string name, std::unique_ptr<FrameSink> sink); // create and launch the thread
+		void stop(); // ask the thread to exit; it owns a reference, so this never waits on a stuck send
+		void enqueue(std::shared_ptr<const std::string> frame); // never blocks
+		bool isDead(); // failed too often or stalled
+		const std::string& getName(){ return name; }
+};
+
+// Fans every frame out to a set of devices. The frame is encoded once and shared by
+// all of the per-device queues.
+class BroadcastSink : public FrameSink {
+	private:
+		std::mutex devicesMutex;
+		std::vector<std::shared_ptr<DeviceSender> > devices;
+		std::shared_ptr<const std::string> lastFrame; // shown to devices as soon as they are added
+
+		void pruneLocked(); // prune with devicesMutex held
+	public:
+		~BroadcastSink();
+
+		void addDevice(std::string name, std::unique_ptr<FrameSink> sink);
+		bool hasDevice(const std::string& name);
+		void prune(); // drop dead devices
+		size_t getDeviceCount();
+		bool send(const std::string& frame);
+		bool sendShared(std::shared_ptr<const std::string> frame);
+};
+
+#endif
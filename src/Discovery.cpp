@@ -0,0 +1,61 @@
+#include "Discovery.h"
+
+DeviceDiscovery::~DeviceDiscovery(){
+	{
+		std::lock_guard<std::mutex> guard(discoveryMutex);
+		stopping = true;
+	}
+	wakeup.notify_all();
+	if(worker.joinable()) worker.join();
+}
+
+void DeviceDiscovery::start(){
+	worker = std::thread(&DeviceDiscovery::run, this);
+}
+
+void DeviceDiscovery::run(){
+	std::unique_lock<std::mutex> lock(discoveryMutex);
+	while(!stopping){
+		lock.unlock();
+		browse();
+		lock.lock();
+		wakeup.wait_for(lock, std::chrono::milliseconds(DISCOVERY_INTERVAL_MS), [this]{ return stopping; });
+	}
+}
+
+bool DeviceDiscovery::attach(const std::string& name, const DeviceMap::mapped_type& service){
+	try {
+		std::unique_ptr<airplay_device> conn(new airplay_device(service));
+		conn->send_message(MessageType::GetServices);
+		broadcast.addDevice(name, std::unique_ptr<FrameSink>(new AirplaySink(std::move(conn))));
+		return true;
+	} catch(...){
+		std::cerr << "Warning: Could not connect to device '" << name << "'." << std::endl;
+		return false;
+	}
+}
+
+void DeviceDiscovery::browse(){
+	broadcast.prune(); // so devices that died since the last pass are seen as missing
+	const DeviceMap devices = airplay_browser::get_devices();
+	auto now = std::chrono::steady_clock::now();
+	for(const auto& pair : devices){
+		const std::string name = pair.first;
+		Attempt& attempt = attempts[name];
+
+		// Devices that stayed attached for a while start over with a short backoff.
+		if(broadcast.hasDevice(name)){
+			if(now - attempt.attached > std::chrono::milliseconds(RECONNECT_STABLE_MS)){
+				attempt.delay = RECONNECT_BACKOFF_MS;
+			}
+			continue;
+		}
+
+		// New, dropped or previously unreachable device: (re)attach once its backoff has expired.
+		// The backoff grows on every attempt, so a device that keeps failing is retried less often.
+		if(now < attempt.next) continue;
+		if(attach(name, pair.second)) attempt.attached = now;
+		attempt.next = now + std::chrono::milliseconds(attempt.delay);
+		attempt.delay = std::min((long)RECONNECT_MAX_BACKOFF_MS, attempt.delay * 2);
+	}
+}
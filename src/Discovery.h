@@ -0,0 +1,46 @@
+#ifndef DISCOVERY_INC
+#define DISCOVERY_INC
+#include "Broadcast.h"
+#include <map>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#define DISCOVERY_INTERVAL_MS 5000 // time between two Bonjour browses
+#define RECONNECT_BACKOFF_MS 2000 // first delay before reattaching a device that was dropped or failed to connect
+#define RECONNECT_MAX_BACKOFF_MS 60000
+#define RECONNECT_STABLE_MS 30000 // a device attached this long has its backoff reset
+
+typedef decltype(airplay_browser::get_devices()) DeviceMap; // device name --> service, as returned by Bonjour
+
+// Browses for Airplay devices on a background thread for the lifetime of the program,
+// attaching new devices to the broadcast as they appear and reattaching dropped ones
+// (e.g. after a reboot) with exponential backoff.
+class DeviceDiscovery {
+	private:
+		struct Attempt {
+			std::chrono::steady_clock::time_point next; // earliest time for the next attach attempt
+			std::chrono::steady_clock::time_point attached; // when the device was last attached
+			long delay = RECONNECT_BACKOFF_MS; // current backoff
+		};
+
+		BroadcastSink& broadcast;
+		std::map<std::string, Attempt> attempts; // by device name, only touched by the discovery thread
+		std::mutex discoveryMutex;
+		std::condition_variable wakeup;
+		bool stopping = false;
+		std::thread worker;
+
+		void run(); // discovery thread body
+		void browse(); // one discovery pass
+		bool attach(const std::string& name, const DeviceMap::mapped_type& service); // connect and add to the broadcast
+	public:
+		DeviceDiscovery(BroadcastSink& b) : broadcast(b){ }
+		~DeviceDiscovery();
+
+		void start(); // launch the discovery thread (returns immediately)
+};
+
+#endif
@@ -0,0 +1,37 @@
+#include "FrameCache.h"
+
+uint64_t hashFrameKey(const std::string& key){
+	uint64_t hash = 14695981039346656037ULL;
+	for(unsigned char c : key){
+		hash ^= c;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+std::shared_ptr<const std::string> FrameCache::get(uint64_t hash, const std::string& key){
+	std::lock_guard<std::mutex> guard(cacheMutex);
+	auto it = index.find(hash);
+	if(it == index.end() || it->second->key != key) return nullptr;
+	order.splice(order.begin(), order, it->second); // mark as most recently used
+	return it->second->frame;
+}
+
+void FrameCache::put(uint64_t hash, const std::string& key, std::shared_ptr<const std::string> frame){
+	if(capacity == 0) return;
+	std::lock_guard<std::mutex> guard(cacheMutex);
+	auto it = index.find(hash);
+	if(it != index.end()){
+		// Replace the existing entry (same hash, possibly a colliding key).
+		it->second->key = key;
+		it->second->frame = frame;
+		order.splice(order.begin(), order, it->second);
+		return;
+	}
+	order.push_front({hash, key, frame});
+	index[hash] = order.begin();
+	if(order.size() > capacity){
+		index.erase(order.back().hash);
+		order.pop_back();
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef FRAMECACHE_INC
+#define FRAMECACHE_INC
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+
+// 64-bit FNV-1a hash of a frame key (a serialization of the render inputs).
+uint64_t hashFrameKey(const std::string& key);
+
+// Bounded LRU cache of encoded frames, keyed by the hash of their render inputs.
+class FrameCache {
+	private:
+		struct Entry {
+			uint64_t hash;
+			std::string key; // full key, to rule out hash collisions
+			std::shared_ptr<const std::string> frame;
+		};
+		const size_t capacity;
+		std::mutex cacheMutex;
+		std::list<Entry> order; // most recently used first
+		std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+	public:
+		FrameCache(size_t c = 16) : capacity(c){ }
+
+		std::shared_ptr<const std::string> get(uint64_t hash, const std::string& key); // nullptr on miss
+		void put(uint64_t hash, const std::string& key, std::shared_ptr<const std::string> frame);
+};
+
+#endif
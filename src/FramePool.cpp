@@ -0,0 +1,39 @@
+#include "FramePool.h"
+
+FramePool::FramePool(int w, int h, unsigned int preallocate) : width(w), height(h) {
+	available.reserve(preallocate * 2);
+	owned.reserve(preallocate * 2);
+	for(unsigned int i = 0; i < preallocate; i++){
+		gdImagePtr im = gdImageCreateTrueColor(width, height);
+		owned.push_back(im);
+		available.push_back(im);
+	}
+}
+
+FramePool::~FramePool(){
+	for(gdImagePtr im : owned){
+		gdImageDestroy(im);
+	}
+}
+
+gdImagePtr FramePool::acquire(){
+	std::lock_guard<std::mutex> guard(poolMutex);
+	if(!available.empty()){
+		gdImagePtr im = available.back();
+		available.pop_back();
+		return im;
+	}
+	gdImagePtr im = gdImageCreateTrueColor(width, height);
+	owned.push_back(im);
+	return im;
+}
+
+void FramePool::release(gdImagePtr im){
+	std::lock_guard<std::mutex> guard(poolMutex);
+	available.push_back(im);
+}
+
+unsigned int FramePool::getAllocations(){
+	std::lock_guard<std::mutex> guard(poolMutex);
+	return owned.size();
+}
@@ -0,0 +1,38 @@
+#ifndef FRAMEPOOL_INC
+#define FRAMEPOOL_INC
+#include <vector>
+#include <mutex>
+#include <gd.h>
+
+// Pool of preallocated truecolor framebuffers of a fixed size, reused across frames
+// so that rendering does not create and destroy a full-screen image every time.
+class FramePool {
+	private:
+		const int width, height;
+		std::mutex poolMutex;
+		std::vector<gdImagePtr> available; // framebuffers ready for reuse
+		std::vector<gdImagePtr> owned; // every framebuffer created by the pool
+	public:
+		FramePool(int width, int height, unsigned int preallocate = 2);
+		~FramePool();
+
+		gdImagePtr acquire(); // take a framebuffer (contents undefined), creating one if the pool is empty
+		void release(gdImagePtr im); // return a framebuffer to the pool
+		unsigned int getAllocations(); // number of framebuffers created so far
+};
+
+// Holds a framebuffer for the duration of a scope.
+class FrameLease {
+	private:
+		FramePool& pool;
+		gdImagePtr im;
+	public:
+		FrameLease(FramePool& p) : pool(p), im(p.acquire()){ }
+		~FrameLease(){ pool.release(im); }
+		FrameLease(const FrameLease&) = delete;
+		FrameLease& operator=(const FrameLease&) = delete;
+
+		gdImagePtr get(){ return im; }
+};
+
+#endif
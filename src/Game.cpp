@@ -1,84 +1,175 @@
 #include "Game.h"
+#include "Startup.h"
 #include <cassert>
 #include <chrono>
+#include <thread>
 
-Game::Game(airplay_device& c) : conn(c){
-	// Initialize wordlist.
-	list = Wordlist();
-	if(!list.readWordlist(WORDLIST_PATH)){
-		std::cerr << "Error: Could not open wordlist." << std::endl;
-		std::exit(1);
-	}
-	list.scoreWords();
+Game::Game(FrameSink* s, std::shared_ptr<GameAssets> a) : sink(s), assets(a), published(std::make_shared<const GameSnapshot>()),
+	rng(nextRandomSeed()){
+	// Nothing slow here; see load().
+}
 
-	// Initialize background image.
-	FILE* in = fopen("background.png", "rb");
-	background = gdImageCreateFromPng(in);
-	fclose(in);
+void Game::load(){
+	assets->load();
+	std::lock_guard<std::mutex> lock(gameMutex);
+	list = assets->getWordlist();
 }
 
 inline int getColor(gdImagePtr& img, int a, int b, int c){
 	return gdImageColorResolve(img, a, b, c);
 }
 
-std::vector<char> Game::getIncorrectGuesses(){
-	gameMutex.lock();
-	std::vector<char> ret;
-	if(mode != MODE_COMPUTER_GUESSES_WORD){
-		for(char ch : guessed){
-			if(word.find(ch) == std::string::npos) ret.push_back(ch);
+// Attributes the time elapsed since the previous lap to one phase of a render profile.
+class RenderClock {
+	private:
+		RenderProfile* profile;
+		std::chrono::steady_clock::time_point last;
+	public:
+		RenderClock(RenderProfile* p) : profile(p){
+			if(profile) last = std::chrono::steady_clock::now();
 		}
-	} else {
-		for(char ch : guessed){
-			if(!guessValidity[ch]) ret.push_back(ch);
+		void lap(double RenderProfile::*phase){
+			if(!profile) return;
+			auto now = std::chrono::steady_clock::now();
+			profile->*phase += std::chrono::duration<double, std::micro>(now - last).count();
+			last = now;
 		}
-	}
-	gameMutex.unlock();
-	return ret;
+};
+
+// gd output context that appends to a string, so frames are encoded straight into the
+// caller's buffer (and its capacity) instead of a buffer gd allocates and we then copy.
+struct StringIOCtx {
+	gdIOCtx ctx; // first, so gd's gdIOCtx* converts back to the StringIOCtx
+	std::string* out;
+};
+
+static int stringPutBuf(gdIOCtx* ctx, const void* buf, int size){
+	reinterpret_cast<StringIOCtx*>(ctx)->out->append((const char*)buf, size);
+	return size;
 }
 
-unsigned int Game::getIncorrectGuessesNum(){
-	gameMutex.lock();
-	unsigned int ret = 0;
-	if(mode != MODE_COMPUTER_GUESSES_WORD){
-		for(char ch : guessed){
-			if(word.find(ch) == std::string::npos) ++ret;
-		}
-	} else {
-		for(char ch : guessed){
-			if(!guessValidity[ch]) ++ret;
-		}
-	}
-	gameMutex.unlock();
-	return ret;
+static void stringPutC(gdIOCtx* ctx, int c){
+	reinterpret_cast<StringIOCtx*>(ctx)->out->push_back((char)c);
 }
 
-std::string Game::getBlankedWord(){
-	gameMutex.lock();
-	std::string blankedWord = "";
+LetterMask Game::incorrectMaskLocked(){
+	// Letters known to be in the word: the word itself, or what the user confirmed when the computer guesses.
+	LetterMask correct = (mode != MODE_COMPUTER_GUESSES_WORD ? wordMask : confirmed);
+	return guessedMask() & ~correct;
+}
+
+unsigned int Game::countIncorrectLocked(){
+	return countLetters(incorrectMaskLocked());
+}
+
+void Game::blankWordLocked(std::string& blankedWord){
+	blankedWord.clear();
 	for(unsigned int i = 0; i < word.length(); i++){
 		char on = word[i];
-		if(std::find(guessed.begin(), guessed.end(), on) == guessed.end()){
+		if(!(guessedMask() & letterBit(on))){
 			on = '_';
 		}
 		if(blankedWord.length()) blankedWord.push_back(' ');
 		blankedWord.push_back(on);
 	}
-	gameMutex.unlock();
-	return blankedWord;
 }
 
-std::string Game::getCurrentGameImage(bool result_screen){
+bool Game::wordSolvedLocked(){
+	return (wordMask & ~guessedMask()) == 0;
+}
+
+void Game::narrowCandidatesLocked(char letter){
+	// An answer settles one letter in every position: where the word now shows it, the
+	// candidates must have it, and everywhere else they must not. Each check is one AND or
+	// AND-NOT of a bit row over all the words of this length.
+	if(!list || candidates.empty() || !letterBit(letter)) return;
+	const BitsetKernels& k = bitsetKernels();
+	const unsigned int length = (unsigned int)word.length();
+	if(!(wordMask & letterBit(letter))){
+		k.andNotRow(candidates.data(), list->wordsWithLetter(length, letter), candidates.size());
+		return;
+	}
+	for(unsigned int i = 0; i < length; i++){
+		if(word[i] == letter) k.andRow(candidates.data(), list->wordsWithLetterAt(length, i, letter), candidates.size());
+		else k.andNotRow(candidates.data(), list->wordsWithLetterAt(length, i, letter), candidates.size());
+	}
+}
+
+void Game::setWordLocked(const std::string& w){
+	word = w;
+	wordMask = wordLetterMask(w);
+	wordRank = (list ? list->getRank(w) : -1);
+	updateGuessStateLocked();
+}
+
+// Packing of guessState.
+static inline uint64_t packGuessState(LetterMask guessed, LetterMask correct, bool open, uint64_t epoch){
+	return (uint64_t)(guessed & LETTER_MASK_ALL) | ((uint64_t)(correct & (LETTER_MASK_ALL | LETTER_MASK_OTHER)) << GUESS_STATE_CORRECT_SHIFT)
+		| (open ? GUESS_STATE_OPEN : 0) | ((epoch & GUESS_STATE_EPOCH_MASK) << GUESS_STATE_EPOCH_SHIFT);
+}
+static inline LetterMask guessStateCorrect(uint64_t packed){
+	return (LetterMask)(packed >> GUESS_STATE_CORRECT_SHIFT) & (LETTER_MASK_ALL | LETTER_MASK_OTHER);
+}
+static inline uint64_t guessStateEpoch(uint64_t packed){
+	return (packed >> GUESS_STATE_EPOCH_SHIFT) & GUESS_STATE_EPOCH_MASK;
+}
+
+void Game::updateGuessStateLocked(LetterMask add){
+	// Lock-free guessers may set bits concurrently, so merge rather than overwrite.
+	// Letters in the word, or confirmed by the user when the computer guesses, are correct.
+	uint64_t cur = guessState.load();
+	uint64_t next;
+	do {
+		next = packGuessState((LetterMask)cur | add, wordMask | confirmed, acceptingGuesses, guessStateEpoch(cur));
+	} while(!guessState.compare_exchange_weak(cur, next));
+}
+
+void Game::resetGuessesLocked(){
+	// A new epoch makes any guess still in flight for the previous round fail its compare-and-swap.
+	guessState.store(packGuessState(0, wordMask | confirmed, acceptingGuesses, guessStateEpoch(guessState.load()) + 1));
+}
+
+void Game::publishLocked(){
+	std::shared_ptr<GameSnapshot> snap = std::make_shared<GameSnapshot>();
+	snap->mode = mode;
+	snap->level = level;
+	snap->levelDiff = levelDiff;
+	snap->score = score;
+	snap->gameInd = gameInd;
+	snap->lastGameResult = lastGameResult;
+	snap->flashDelay = flashDelay;
+	snap->waitingForWord = waitingForWord;
+	snap->allowAnyWord = allowAnyWord;
+	snap->word = word;
+	snap->wordRank = wordRank;
+	snap->wordCount = (list ? (uint32_t)list->getSortedWords().size() : 0U);
+	blankWordLocked(snap->blankedWord);
+	snap->guessed = guessedMask();
+	snap->incorrect = incorrectMaskLocked();
+	snap->alert = alert;
+	snap->version = published->version + 1; // only writers (who hold gameMutex) replace published
+	std::atomic_store(&published, std::shared_ptr<const GameSnapshot>(std::move(snap)));
+}
+
+void Game::publish(){
+	std::lock_guard<std::mutex> lock(gameMutex);
+	publishLocked();
+}
+
+bool Game::renderGameImage(const GameSnapshot& state, bool result_screen, std::string& out){
 	// Initialize constants and variables.
 	int brect[8], xPos, yPos, diff;
 	double size;
 	char* err;
+	char text[128]; // scratch for short formatted strings
 	const int width = 1920, height = 1080; // 1920 x 1080
 	char* font_times = const_cast<char*>("fonts/times.ttf");
+	RenderClock clock(profile);
 
-	// Initialize the image from the background image.
-	gdImagePtr im = gdImageCreateTrueColor(background->sx, background->sy);
-	gdImageCopy(im, background, 0, 0, 0, 0, im->sx, im->sy);
+	// Initialize a pooled framebuffer from the background image.
+	FrameLease lease(*assets->frames);
+	gdImagePtr im = lease.get();
+	blitOpaque(im, assets->background, 0, 0);
 
 	// Initialize selected colors.
 	int red = getColor(im, 255, 0, 0);
@@ -88,34 +179,34 @@ std::string Game::getCurrentGameImage(bool result_screen){
 	int keyboard_color = getColor(im, 137, 138, 99);
 	int rank_color = getColor(im, 65, 145, 75);
 	int cross_color = getColor(im, 100, 90, 80);
+	clock.lap(&RenderProfile::composite);
 
 	// Write the score at the bottom-left corner of the screen. //
-	if(mode == MODE_COMPUTER_PICKS_WORD){
-		std::stringstream score_text;
-		score_text << "Score: " << score;
+	if(state.mode == MODE_COMPUTER_PICKS_WORD){
+		snprintf(text, sizeof(text), "Score: %d", state.score);
 		xPos = 75;
 		yPos = 70;
-		err = gdImageStringFT(im, &brect[0], cross_color, font_times, 40.0, 0.0, xPos, yPos, const_cast<char*>(score_text.str().c_str()));
+		err = gdImageStringFT(im, &brect[0], cross_color, font_times, 40.0, 0.0, xPos, yPos, text);
 		if(err){
 			std::cerr << err << std::endl;
-			return "";
+			return false;
 		}
 	}
 
 	// Write the level of the game and the total number of levels. //
-	if(mode == MODE_COMPUTER_PICKS_WORD){
-		std::stringstream level_text;
-		level_text << "Level " << level << "/" << NUM_LEVELS;
+	if(state.mode == MODE_COMPUTER_PICKS_WORD){
+		snprintf(text, sizeof(text), "Level %u/%d", state.level, NUM_LEVELS);
 		xPos = 1630;
 		yPos = 70;
-		err = gdImageStringFT(im, &brect[0], blue, font_times, 40.0, 0.0, xPos, yPos, const_cast<char*>(level_text.str().c_str()));
+		err = gdImageStringFT(im, &brect[0], blue, font_times, 40.0, 0.0, xPos, yPos, text);
 		if(err){
 			std::cerr << err << std::endl;
-			return "";
+			return false;
 		}
 	}
+	clock.lap(&RenderProfile::text);
 
-	if(result_screen && !waitingForWord){
+	if(result_screen && !state.waitingForWord){
 		// Write the word across the screen, optimizing the size. //
 		// Get the bounding rectangle and optimize the size and position based on that.
 		size = 40.0;
@@ -126,12 +217,13 @@ std::string Game::getCurrentGameImage(bool result_screen){
 		diff = DIFF_MAX + 1;
 		xPos = 75;
 		yPos = BASE_WORD_HEIGHT;
-		std::string word_text = "The word was: " + word + ".";
+		std::string& word_text = textBuf;
+		word_text.assign("The word was: ").append(state.word).push_back('.');
 		while(diff > DIFF_MAX){
-			err = gdImageStringFT(NULL, &brect[0], blue_144_color, font_times, size, 0.0, xPos, yPos, const_cast<char*>(word_text.c_str()));
+			err = gdImageStringFT(NULL, &brect[0], blue_144_color, font_times, size, 0.0, xPos, yPos, &word_text[0]);
 			if(err){
 				std::cerr << err << std::endl;
-				return "";
+				return false;
 			}
 			// 750 is lower y-line.
 			diff = width - brect[2];
@@ -145,33 +237,31 @@ std::string Game::getCurrentGameImage(bool result_screen){
 				yPos += (MAX_Y_REACH - 100) - brect[3];
 			}
 		}
+		clock.lap(&RenderProfile::layout);
 
 		// Write the word with the optimized size and/or position.
-		gdImageStringFT(im, &brect[0], (lastGameResult == 1 ? green : red), font_times, size, 0.0, xPos, yPos, const_cast<char*>(word_text.substr(0, 14).c_str()));
-		gdImageStringFT(im, &brect[0], blue_144_color, font_times, size, 0.0, brect[2], yPos, const_cast<char*>(word_text.substr(14).c_str()));
+		auxBuf.assign(word_text, 0, 14);
+		gdImageStringFT(im, &brect[0], (state.lastGameResult == 1 ? green : red), font_times, size, 0.0, xPos, yPos, &auxBuf[0]);
+		gdImageStringFT(im, &brect[0], blue_144_color, font_times, size, 0.0, brect[2], yPos, &word_text[14]);
+		clock.lap(&RenderProfile::text);
 
 		// Show if the user levelled up or down, if applicable. //
-		if(levelDiff != 0 || (lastGameResult == 1 && level == NUM_LEVELS)){
+		if(state.levelDiff != 0 || (state.lastGameResult == 1 && state.level == NUM_LEVELS)){
 			// Generate the level up/down text.
-			std::string level_text = (abs(levelDiff) == 1 ? "level" : "levels");
-			int color = (lastGameResult == 1 ? green : red);
-			std::stringstream text;
-			if(levelDiff){
-				if(lastGameResult == 1){
-					text << "You win! ";
+			const char* levels_word = (abs(state.levelDiff) == 1 ? "level" : "levels");
+			int color = (state.lastGameResult == 1 ? green : red);
+			if(state.levelDiff){
+				const char* outcome = (state.lastGameResult == 1 ? "You win! " : "You lose! ");
+				if(state.levelDiff > 0){
+					snprintf(text, sizeof(text), "%sCongratulations! You moved up %d %s!", outcome, state.levelDiff, levels_word);
 				} else {
-					text << "You lose! ";
-				}
-				if(levelDiff > 0){
-					text << "Congratulations! You moved up " << levelDiff << " " << level_text << "!";
-				} else {
-					text << "You moved down " << abs(levelDiff) << " " << level_text << ".";
+					snprintf(text, sizeof(text), "%sYou moved down %d %s.", outcome, abs(state.levelDiff), levels_word);
 				}
 			} else {
 				// Victory message
-				text << "You beat the gauntlet! You can now play for fun.";
+				snprintf(text, sizeof(text), "You beat the gauntlet! You can now play for fun.");
 			}
-			level_text = text.str();
+			char* level_text = text;
 
 			// Optimize the size of it.
 			xPos = 75;
@@ -179,52 +269,43 @@ std::string Game::getCurrentGameImage(bool result_screen){
 			brect[2] = width + 1;
 			size = 40.0;
 			while(brect[2] > width){
-				err = gdImageStringFT(NULL, &brect[0], blue_144_color, font_times, size, 0.0, xPos, yPos, const_cast<char*>(level_text.c_str()));
+				err = gdImageStringFT(NULL, &brect[0], blue_144_color, font_times, size, 0.0, xPos, yPos, level_text);
 				if(err){
 					std::cerr << err << std::endl;
-					return "";
+					return false;
 				}
 				if(brect[2] > width) size -= GRANULARITY;
 			}
+			clock.lap(&RenderProfile::layout);
 
 			// Write it with the optimized size.
-			gdImageStringFT(im, &brect[0], color, font_times, size, 0.0, xPos, yPos, const_cast<char*>(level_text.c_str()));
+			gdImageStringFT(im, &brect[0], color, font_times, size, 0.0, xPos, yPos, level_text);
+			clock.lap(&RenderProfile::text);
 		}
 
 		// Write the definition of the word. //
 		// TODO
-	} else if(!result_screen && !waitingForWord){
+	} else if(!result_screen && !state.waitingForWord){
 		// Illustrate the guessing progress with a progress bar and the image for the corresponding stage. //
 		// Write the progress bar.
 		int leftX = 298, leftY = 305;
 		const int GUESS_RECT_WIDTH = 50, GUESS_RECT_HEIGHT = 50;
-		const auto incorrect_guesses = getIncorrectGuessesNum();
+		const auto incorrect_guesses = countLetters(state.incorrect);
 		for(unsigned int i = 0; i < GUESS_LIMIT; i++){
-			gdPointPtr pts = new gdPoint[4];
-			pts[0].x = leftX; pts[0].y = leftY;
-			pts[1].x = leftX + GUESS_RECT_WIDTH; pts[1].y = leftY;
-			pts[2].x = leftX + GUESS_RECT_WIDTH; pts[2].y = leftY + GUESS_RECT_HEIGHT;
-			pts[3].x = leftX; pts[3].y = leftY + GUESS_RECT_HEIGHT;
+			fillRect(im, leftX, leftY, leftX + GUESS_RECT_WIDTH, leftY + GUESS_RECT_HEIGHT, (i < incorrect_guesses ? red : rank_color));
 			leftX += GUESS_RECT_WIDTH * 1.5;
-			gdImageFilledPolygon(im, pts, 4, (i < incorrect_guesses ? red : rank_color));
 		}
 
 		// And write the guessing stage as an image (a.k.a. the actual hangman).
-		std::stringstream stage_file;
-		stage_file << "data/stage" << (getIncorrectGuessesNum() + 1) << ".png";
-		FILE* in = fopen(stage_file.str().c_str(), "rb");
-		if(!in){
-			std::cerr << "Could not open '" << stage_file.str() << "' for reading hangman stage." << std::endl;
-			return "";
-		}
-		gdImagePtr stage_img = gdImageCreateFromPng(in);
-		fclose(in);
-		gdImageCopy(im, stage_img, 1375, 100, 0, 0, stage_img->sx, stage_img->sy);
+		gdImagePtr stage_img = assets->stages[std::min(incorrect_guesses, (unsigned int)GUESS_LIMIT)];
+		blitAlpha(im, stage_img, 1375, 100);
+		clock.lap(&RenderProfile::composite);
 
 		// Write the word down as blanks (underscores), substituting the actual letter where
 		// guessed correctly, and optimize the size using the bounding rectangle.
 		// Generate the "blanked" word.
-		std::string blankedWord = getBlankedWord();
+		std::string& blankedWord = textBuf;
+		blankedWord.assign(state.blankedWord);
 
 		// Get the bounding rectangle and optimize the size and position based on that.
 		const int MIN_Y_REACH = brect[3] + 10;
@@ -236,10 +317,10 @@ std::string Game::getCurrentGameImage(bool result_screen){
 		xPos = 75;
 		yPos = 540;
 		while(diff > DIFF_MAX){
-			err = gdImageStringFT(NULL, &brect[0], blue_144_color, font_times, size, 0.0, xPos, yPos, const_cast<char*>(blankedWord.c_str()));
+			err = gdImageStringFT(NULL, &brect[0], blue_144_color, font_times, size, 0.0, xPos, yPos, &blankedWord[0]);
 			if(err){
 				std::cerr << err << std::endl;
-				return "";
+				return false;
 			}
 			// 750 is lower y-line.
 			diff = width - brect[2];
@@ -257,9 +338,12 @@ std::string Game::getCurrentGameImage(bool result_screen){
 				yPos = std::max(yPos, MIN_Y_REACH);
 			}
 		}
+		clock.lap(&RenderProfile::layout);
 
 		// Write the blanked word with the optimized size and/or position.
-		gdImageStringFT(im, &brect[0], blue_144_color, font_times, size, 0.0, xPos, yPos, const_cast<char*>(blankedWord.c_str()));
+		gdImageStringFT(im, &brect[0], blue_144_color, font_times, size, 0.0, xPos, yPos, &blankedWord[0]);
+
+		clock.lap(&RenderProfile::text);
 
 		// Draw a "keyboard" and mark all letters that have already been guessed, and whether
 		// it was a correct/incorrect guess.
@@ -272,9 +356,9 @@ std::string Game::getCurrentGameImage(bool result_screen){
 			int color = keyboard_color;
 			bool should_cross = false;
 			bool correct = false;
-			if(std::find(guessed.begin(), guessed.end(), std::tolower(ch)) != guessed.end()){
+			if(state.guessed & letterBit(std::tolower(ch))){
 				should_cross = true;
-				if(word.find(std::tolower(ch)) != std::string::npos){
+				if(!(state.incorrect & letterBit(std::tolower(ch)))){
 					correct = true;
 					color = green;
 				} else {
@@ -283,13 +367,12 @@ std::string Game::getCurrentGameImage(bool result_screen){
 			}
 
 			// Write the letter.
-			std::string letter;
-			letter.push_back(ch);
-			//printf("|(%s) - (%c)| at (%d, %d)\n", letter.c_str(), ch, xPos, yPos);
-			err = gdImageStringFT(im, &brect[0], color, font_times, 40.0, 0.0, xPos, yPos, const_cast<char*>(letter.c_str()));
+			char letter[2] = {ch, '\0'};
+			//printf("|(%s) - (%c)| at (%d, %d)\n", letter, ch, xPos, yPos);
+			err = gdImageStringFT(im, &brect[0], color, font_times, 40.0, 0.0, xPos, yPos, letter);
 			if(err){
 				std::cerr << err << std::endl;
-				return "";
+				return false;
 			}
 
 			// Cross the letter out, if applicable.
@@ -317,60 +400,109 @@ std::string Game::getCurrentGameImage(bool result_screen){
 			}
 			++ch;
 		}
+		clock.lap(&RenderProfile::text);
 
 		// Write the word rank, optimizing for space (right-aligning) using the bounding rectangle. //
-		if(mode == MODE_COMPUTER_PICKS_WORD){
+		if(state.mode == MODE_COMPUTER_PICKS_WORD){
 			// Generate word rank text.
-			std::stringstream difficulty_text;
-			auto& words = list.getSortedWords();
-			difficulty_text << "Word Rank: #" << std::distance(words.begin(), std::find(words.begin(), words.end(), word));
-			difficulty_text << "/" << words.size();
+			long rank = (state.wordRank >= 0 ? state.wordRank : (long)state.wordCount);
+			snprintf(text, sizeof(text), "Word Rank: #%ld/%lu", rank, (unsigned long)state.wordCount);
+			char* difficulty_text = text;
 
 			// Optimize text position using the bounding rectangle.
 			xPos = 1250;
 			yPos = 1050;
-			err = gdImageStringFT(NULL, &brect[0], rank_color, font_times, 40.0, 0.0, xPos, yPos, const_cast<char*>(difficulty_text.str().c_str()));
+			err = gdImageStringFT(NULL, &brect[0], rank_color, font_times, 40.0, 0.0, xPos, yPos, difficulty_text);
 			if(err){
 				std::cerr << err << std::endl;
-				return "";
+				return false;
 			}
 
+			clock.lap(&RenderProfile::layout);
+
 			// Write the word rank text in the optimized position.
 			diff = (width - 20) - brect[2];
 			xPos += diff;
-			gdImageStringFT(im, &brect[0], rank_color, font_times, 40.0, 0.0, xPos, yPos, const_cast<char*>(difficulty_text.str().c_str()));
+			gdImageStringFT(im, &brect[0], rank_color, font_times, 40.0, 0.0, xPos, yPos, difficulty_text);
+			clock.lap(&RenderProfile::text);
 		}
-	} else if(waitingForWord){
+	} else if(state.waitingForWord){
 		xPos = 75;
 		yPos = 400;
 		size = 72.0;
 		err = gdImageStringFT(im, &brect[0], rank_color, font_times, size, 0.0, xPos, yPos, (char*)"Waiting for user to choose a word...");
 		if(err){
 			std::cerr << err << std::endl;
-			return "";
+			return false;
 		}
+		clock.lap(&RenderProfile::text);
 	}
 
-	// Get JPEG text.
-	int jpegSize;
-	char* jpeg_data = (char*)gdImageJpegPtr(im, &jpegSize, 100);
-	std::string ret;
-	for(int i = 0; i < jpegSize; i++){
-		ret.push_back(jpeg_data[i]);
+	// Get JPEG text (reusing the capacity of the output buffer).
+	StringIOCtx jpeg = {};
+	jpeg.ctx.putBuf = stringPutBuf;
+	jpeg.ctx.putC = stringPutC;
+	jpeg.out = &out;
+	out.clear();
+	gdImageJpegCtx(im, &jpeg.ctx, 100);
+	if(out.empty()){
+		std::cerr << "Could not encode game image." << std::endl;
+		return false;
 	}
-	gdFree(jpeg_data);
+	clock.lap(&RenderProfile::encode);
+	if(profile) ++profile->frames;
+	return true;
+}
 
-	// Clean up.
-	gdImageDestroy(im);
+std::string Game::getCurrentGameImage(bool result_screen){
+	std::string ret;
+	if(!renderGameImage(*getSnapshot(), result_screen, ret)) return "";
 	return ret;
 }
 
-void Game::showPicture(std::string& data){
-	// AirplayImage* img = new AirplayImage();
-	// img->size = data.length();
-	// img->data = (void*)data.c_str();
-	conn.send_message(MessageType::ShowPicture, data);
-	// delete img;
+bool Game::showPicture(std::shared_ptr<const std::string> data){
+	if(!sink) return true;
+	if(!sink->sendShared(data)){
+		std::cerr << "Warning: Could not show picture." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+std::string Game::getFrameKey(const GameSnapshot& state, bool result_screen){
+	std::stringstream key;
+	key << state.mode << "|" << result_screen << "|" << state.waitingForWord << "|" << state.level << "|" << state.score;
+	key << "|" << state.levelDiff << "|" << state.lastGameResult << "|" << state.word << "|" << state.wordRank << "/" << state.wordCount << "|" << std::hex << state.guessed;
+	return key.str();
+}
+
+void Game::presentFrame(bool result_screen){
+	if(!sink && !snapshots) return; // nobody is watching this game (e.g. a web-only room)
+
+	// Skip everything if the screen already shows this state. Key and image come from the
+	// same snapshot, so a cached frame always matches its key.
+	std::shared_ptr<const GameSnapshot> state = getSnapshot();
+	const std::string key = getFrameKey(*state, result_screen);
+	const uint64_t hash = hashFrameKey(key);
+	if(sentAny && hash == lastSentHash) return;
+
+	// Reuse the encoded frame if this state was rendered recently.
+	std::shared_ptr<const std::string> frame = assets->frameCache.get(hash, key);
+	if(!frame){
+		std::string image;
+		if(!renderGameImage(*state, result_screen, image)) return; // error already reported
+		frame = std::make_shared<const std::string>(std::move(image));
+		assets->frameCache.put(hash, key, frame);
+	}
+
+	// Show it, remembering what is on screen only if it got there.
+	if(snapshots) snapshots->submit(frame);
+	if(showPicture(frame)){
+		lastSentHash = hash;
+		sentAny = true;
+		static std::atomic<bool> firstFrame(false);
+		startupMilestoneOnce(firstFrame, "first frame");
+	}
 }
 
 int Game::computeScoreChange(bool won, unsigned int level){
@@ -383,46 +515,85 @@ int Game::computeScoreChange(bool won, unsigned int level){
 	else return (int)((-2)*NUM_LEVELS*std::sqrt(1.0/lvl));
 }
 
-int Game::guessLetter(char letter){
-	gameMutex.lock();
-	guessed.push_back(letter);
-	int ret = 0;
+GuessResult Game::guessLetter(char letter){
+	// Validate and claim the letter with one compare-and-swap on the packed state, so concurrent
+	// guessers never both get the same letter or go past the limit. Rejected guesses (e.g. a whole
+	// room pressing the same letter) never touch gameMutex; only the one that lands takes it,
+	// briefly, to count the letter and publish the new state.
+	GuessResult result;
+	const LetterMask bit = letterBit(letter);
+	if(!bit){
+		result.status = GUESS_INVALID_LETTER;
+		return result;
+	}
+	uint64_t cur = guessState.load();
+	while(true){
+		const LetterMask guessed = (LetterMask)cur & LETTER_MASK_ALL;
+		const LetterMask correct = guessStateCorrect(cur);
+		if(!(cur & GUESS_STATE_OPEN) || (correct & ~guessed) == 0){
+			result.status = GUESS_NOT_PLAYING; // between rounds, or waiting for a word
+			return result;
+		}
+		if(guessed & bit){
+			result.status = GUESS_ALREADY_GUESSED;
+			return result;
+		}
+		if(countLetters(guessed & ~correct) >= GUESS_LIMIT){
+			result.status = GUESS_NO_GUESSES_LEFT;
+			return result;
+		}
+		if(guessState.compare_exchange_weak(cur, cur | bit)) break;
+	}
+	result.status = ((guessStateCorrect(cur) & bit) ? GUESS_CORRECT : GUESS_INCORRECT);
+
+	std::lock_guard<std::mutex> lock(gameMutex);
+	if(guessStateEpoch(guessState.load()) != guessStateEpoch(cur)){
+		// A new round began between the CAS and here, so the guess went to a round that is over.
+		result.status = GUESS_NOT_PLAYING;
+		return result;
+	}
 	for(unsigned long int i = 0; i < word.length(); i++){
-		if(word[i] == letter) ++ret;
+		if(word[i] == letter) ++result.instances;
 	}
-	gameMutex.unlock();
-	return ret;
+	signalEventLocked();
+	return result;
 }
 
 std::string Game::chooseWord(std::string new_word){
 	// Note: Level and other such variables are not filled in on purpose.
-	level = 1e9; // signifies that level is N/A in this mode
 	if(new_word.length() < MIN_LETTERS) return "Word too short!";
-	auto& words = list.getSortedWords();
 	std::transform(new_word.begin(), new_word.end(), new_word.begin(), ::tolower);
-	// if(std::find(words.begin(), words.end(), new_word) == words.end()) return "Word not in dictionary!";
 	gameMutex.lock();
-	this->word = new_word;
+	if(!allowAnyWord && !(list && list->contains(new_word))){
+		gameMutex.unlock();
+		return "Word not in dictionary!";
+	}
+	level = 1e9; // signifies that level is N/A in this mode
+	acceptingGuesses = true;
+	setWordLocked(new_word);
 	this->waitingForWord = false;
+	signalEventLocked();
 	gameMutex.unlock();
 	return "";
 }
 
+void Game::setAllowAnyWord(bool allow){
+	std::lock_guard<std::mutex> lock(gameMutex);
+	allowAnyWord = allow;
+	publishLocked();
+}
+
 std::string Game::chooseLength(int length){
 	// Note: Level and other such variables are not filled in on purpose.
-	level = 1e9; // signifies that level is N/A in this mode
 	if(length < 1) return "Length too short!";
-	auto& words = list.getSortedWords();
-	bool works = false;
-	for(std::string& word : words){
-		if(word.length() == (unsigned)length){
-			works = true;
-			break;
-		}
-	}
-	if(!works) return "No word with specified length in dictionary!";
 	gameMutex.lock();
+	if(!list || !list->hasLength((unsigned int)length)){
+		gameMutex.unlock();
+		return "No word with specified length in dictionary!";
+	}
+	level = 1e9; // signifies that level is N/A in this mode
 	this->wordLength = (unsigned int)length;
+	signalEventLocked();
 	gameMutex.unlock();
 	return "";
 }
@@ -431,12 +602,13 @@ std::string Game::saveGuessResult(std::string result){
 	if(result == "yes" || result == "no"){
 		bool suc = (result == "yes");
 		gameMutex.lock();
-		if(std::find(guessed.begin(), guessed.end(), lastComputerGuess) != guessed.end()){
+		const LetterMask bit = letterBit(lastComputerGuess);
+		if(!bit || (guessedMask() & bit)){
 			gameMutex.unlock();
 			return "Someone already confirmed/denied if that letter was in the word!";
 		}
-		guessed.push_back(lastComputerGuess);
-		guessValidity[lastComputerGuess] = suc;
+		if(suc) confirmed |= bit;
+		updateGuessStateLocked(bit);
 		if(suc){ // if yes, ask where the letters are in it
 			std::stringstream fmt;
 			fmt << "%prompt(Letter's Location in Word, /setWordLocations, word, Where is the letter ";
@@ -444,8 +616,10 @@ std::string Game::saveGuessResult(std::string result){
 			alert = fmt.str();
 		} else {
 			alert = "";
+			narrowCandidatesLocked(lastComputerGuess);
 			lastComputerGuess = '\0'; // letter incorrect - do next guess
 		}
+		signalEventLocked();
 		gameMutex.unlock();
 		return "";
 	} else return "Invalid option sent by browser!";
@@ -470,16 +644,38 @@ std::string Game::saveWordLocations(std::string str){
 		}
 	}
 	gameMutex.lock();
-	this->word = str;
+	setWordLocked(str);
+	narrowCandidatesLocked(lastComputerGuess);
 	lastComputerGuess = '\0';
+	signalEventLocked();
 	gameMutex.unlock();
 	return "";
 }
 
+std::string Game::saveActualWord(std::string str){
+	std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+	std::lock_guard<std::mutex> lock(gameMutex);
+	if(!waitingForActualWord) return "Not waiting for the word!";
+	if(word.length() != str.length()){
+		return "Word is wrong length!";
+	}
+	for(unsigned int i = 0; i < str.length(); i++){
+		if(str[i] < 'a' || str[i] > 'z') return "Word must only contain letters!";
+		if(word[i] != '_' && str[i] != word[i]){
+			return "The word does not match the letters already found!";
+		}
+		if(word[i] == '_' && (guessedMask() & letterBit(str[i]))){
+			return "The word contradicts an earlier answer!"; // letter was denied, or confirmed elsewhere
+		}
+	}
+	setWordLocked(str);
+	waitingForActualWord = false;
+	signalEventLocked();
+	return "";
+}
+
 std::string Game::getWordHTMLForm(){
-	gameMutex.lock();
-	const std::string str = this->word;
-	gameMutex.unlock();
+	const std::string str = getSnapshot()->word;
 	/*
 	<div class="input-group">
 		<input class="form-control" type="text" maxlength="1" placeholder="a">
@@ -530,164 +726,138 @@ char Game::nextLetterToGuess(){
 	*	- e.g. In above example, we would guess "x" with a probability of 100% of being
 	*		   on the blank, versus taking a 50-50 chance with "y" or "c".
 	*/
-	// Generate the subset of the word list. //
-	bool guessedLetter[26]; // [letter #] --> [guessed or not]
-	for(char c = 'a'; c <= 'z'; c++){
-		int ind = (int)(c - 'a');
-		if(std::find(guessed.begin(), guessed.end(), c) != guessed.end()){
-			guessedLetter[ind] = true;
-		} else {
-			guessedLetter[ind] = false;
-		}
-	}
-	auto& words = list.getSortedWords();
-	auto orig = this->word;
-	std::vector<std::reference_wrapper<std::string> > wordSubset;
-	for(std::string& word : words){
-		if(word.length() != wordLength) continue; // the words are not the same length
-		bool works = true;
-		for(unsigned int i = 0; works && i < word.length(); i++){
-			char on = word[i];
-			int ind = (int)(on - 'a');
-			if(orig[i] != '_' && orig[i] != on) works = false; // the words thus far don't match up
-			if(guessedLetter[ind]){
-				if(!guessValidity[on]) works = false; // we guessed this letter and it was not there
-				if(guessValidity[on] && orig[i] == '_') works = false; // we guessed this letter, and it was in the word but not here
-			}
-		}
-		if(!works) continue;
-		wordSubset.push_back(word);
-	}
-
-	// Count the occurences of each letter in each blank using the subset of possible words. //
-	std::map<unsigned int, std::map<char, unsigned long long> > blank_counts;
-	for(std::string& word : wordSubset){
-		for(unsigned int i = 0; i < word.length(); i++){
-			if(orig[i] == '_'){
-				char on = word[i];
-				auto& map = blank_counts[i];
-				if(map.find(on) == map.end()){
-					map[on] = 1ULL;
-				} else {
-					++map[on];
-				}
+	// The subset of the word list is kept in candidates, narrowed as each answer comes in. //
+	std::lock_guard<std::mutex> lock(gameMutex);
+	const LetterMask guessed = guessedMask();
+	const unsigned int length = (unsigned int)word.length();
+	const BitsetKernels& k = bitsetKernels();
+	const uint64_t remaining = k.andCount(candidates.data(), candidates.data(), candidates.size());
+
+	// Count the occurences of each letter in each blank using the subset of possible words, and
+	// guess the letter that has the highest probability for any blank. Every candidate has one
+	// letter in each blank, so that probability is count / candidates. Guessed letters cannot
+	// be in a blank of any candidate, so they are not counted.
+	char guessingLetter = '\0';
+	double maxProb = 0.0;
+	for(unsigned int i = 0; remaining && i < length; i++){
+		if(word[i] != '_') continue;
+		std::cerr << "Blank #" << i << ":\n";
+		for(char c = 'a'; c <= 'z'; c++){
+			if(guessed & letterBit(c)) continue;
+			uint64_t count = k.andCount(candidates.data(), list->wordsWithLetterAt(length, i, c), candidates.size());
+			if(!count) continue;
+			double prob = 100.0 * (double)count / (double)remaining;
+			std::cerr << "\t" << c << ": " << prob << "%" << std::endl;
+			if(prob > maxProb){
+				maxProb = prob;
+				guessingLetter = c;
 			}
 		}
 	}
 
-	// Compute the probability, by blank, of each letter appearing in the blank. //
-	std::map<unsigned int, std::map<char, double> > probabilities;
-	for(auto& pair : blank_counts){
-		unsigned long long total = 0;
-		for(auto& on : std::get<1>(pair)){
-			total += std::get<1>(on);
-		}
-		std::cerr << "Blank #" << std::get<0>(pair) << ":\n";
-		for(auto& on : std::get<1>(pair)){
-			double prob = 100.0f * (double)std::get<1>(on) / (double)total;
-			probabilities[std::get<0>(pair)][std::get<0>(on)] = prob;
-			std::cerr << "\t" << std::get<0>(on) << ": " << prob << "%" << std::endl;
+	// No word fits (the user's word is not in the list, or an answer was wrong): fall back to
+	// the most common letter not guessed yet.
+	if(!guessingLetter){
+		for(unsigned int c = 0; c < 26; c++){
+			if(guessed & ((LetterMask)1 << c)) continue;
+			if(!guessingLetter || LETTER_FREQUENCIES[c] > LETTER_FREQUENCIES[guessingLetter - 'a']) guessingLetter = (char)('a' + c);
 		}
 	}
-
-	// Find the letter that has the highest probability for any blank and guess it.
-	char guessingLetter;
-	double maxProb;
-	for(auto& pair: probabilities){
-		for(auto& on : std::get<1>(pair)){
-			double prob = std::get<1>(on);
-			if(prob > maxProb){
-				maxProb = prob;
-				guessingLetter = std::get<0>(on);
-			}
-		}
-	}
-	assert(std::find(guessed.begin(), guessed.end(), guessingLetter) == guessed.end());
+	assert(guessingLetter && !(guessed & letterBit(guessingLetter)));
 	return guessingLetter;
 }
 
-void Game::start_game(unsigned int theLevel, GameMode theMode){
-	/*
-	* Modes:
-	* 1. Computer picks a word at a specified level, and user guesses.
-	* 	- Extension: Collaborative guessing, word suggestions, over wireless/HTTP server - CHECK.
-	* 	- Extension: Every time the user guesses something correctly, the computer tries to alter the word
-	* 	  instead and find another possibility that fits with the restrictions (length, guessed, etc.)
-	* 	  imposed so far, making it much, much harder - TODO.
-	* 2. User thinks of a word at a specified level, and computer guesses.
-	* 3. User thinks of a word while other users try to guess it, and computer is an arbiter and a screen.
-	*/
-
-	// Instantiate necessary variables.
-	this->level = theLevel;
-	this->mode = theMode;
-
-	while(true){ // everything is in a loop so the mode and level can be changed on-demand
-		// Handle current mode. //
-		while(mode == MODE_COMPUTER_PICKS_WORD){
-			// Reset everything.
-			levelDiff = 0;
-			gameMutex.lock();
-			word = ""; // clear word
-			alert = ""; // clear alerts
-			guessed.clear(); // clear guessed letters
-			lastGameResult = -1; // set game to ongoing state
-			gameMutex.unlock();
+bool Game::roundInProgress(){
+	std::lock_guard<std::mutex> lock(gameMutex);
+	if(waitingForWord) return true;
+	return countIncorrectLocked() < GUESS_LIMIT && !wordSolvedLocked();
+}
 
-			// Mark the time. //
-			auto now = std::chrono::system_clock::now();
-			auto duration = now.time_since_epoch();
-			auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+std::string Game::drawWordLocked(unsigned int level){
+	level = std::max(1U, std::min(level, (unsigned int)NUM_LEVELS));
+	uint32_t begin = list->getLevelBegin(level), end = list->getLevelEnd(level);
+	if(begin == end) return ""; // no words at all
+	ShuffleBag& bag = levelBags[level - 1];
+	if(!bag.covers(begin, end)) bag.reset(begin, end); // first draw since the wordlist changed
+	return std::string(list->getSortedWords()[bag.draw(rng)]);
+}
 
+void Game::beginRound(){
+	// Reset everything, and pick up the latest wordlist (a reload never changes a round in progress).
+	gameMutex.lock();
+	std::shared_ptr<const Wordlist> latest = assets->getWordlist();
+	if(latest != list){
+		list = latest;
+		for(ShuffleBag& bag : levelBags) bag = ShuffleBag(); // refilled from the new list on first draw
+	}
+	levelDiff = 0;
+	acceptingGuesses = false;
+	confirmed = 0; // clear computer guesses
+	candidates.clear();
+	setWordLocked(""); // clear word
+	alert = ""; // clear alerts
+	lastGameResult = -1; // set game to ongoing state
+	switch(mode){
+		case MODE_COMPUTER_PICKS_WORD:
 			// Pick a word at the specified level.
-			gameMutex.lock();
-			word = list.getWordAtLevel(level);
+			acceptingGuesses = true;
+			setWordLocked(drawWordLocked(level));
 			printf("Chosen word: %s (%lu letters) at level %u.\n", word.c_str(), word.length(), level);
-			gameMutex.unlock();
-
-			// Loop, updating the game image each time.
-			while(getIncorrectGuessesNum() < GUESS_LIMIT && getBlankedWord().find('_') != std::string::npos){
-				// Generate the current game image and display it.
-				std::string img = getCurrentGameImage();
-				std::ofstream ofp("out.jpeg", std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
-				ofp.write(img.c_str(), img.length());
-				ofp.close();
-				showPicture(img);
-
-				// Sleep so as not to create a busy loop. //
-				sleep(1);
-			}
+			state = STATE_PLAYING;
+			break;
+		case MODE_USER_PICKS_WORD:
+			// Wait for the user to pick the word.
+			// TODO: Have alerts/server broadcasts have a "timestamp" field, and provide a macro language
+			// to embed constructs such as timers counting down to a specified unix time (e.g. for flash delay
+			// between rounds).
+			score = -1e9; // signifies N/A
+			waitingForWord = true;
+			state = STATE_PLAYING;
+			break;
+		case MODE_COMPUTER_GUESSES_WORD:
+			// Prompt the user for the number of letters.
+			score = -1e9; // signifies N/A
+			wordLength = 0U;
+			waitingForActualWord = false;
+			std::cerr << "Random word: " << list->getWordAtLevel(rng.below(NUM_LEVELS) + 1) << std::endl;
+			// %prompt(Title, /url, variable_name_in_url, Label, Type ("text"|"number"))
+			alert = "%prompt(Number of letters in word, /setWordLength, length, Length, number)";
+			state = STATE_WAITING_FOR_LENGTH;
+			break;
+	}
+	resetGuessesLocked(); // clear guessed letters
+	gameMutex.unlock();
+}
 
-			// TODO: Bonus based on time.
-			// Mark win/loss.
-			if(getIncorrectGuessesNum() >= GUESS_LIMIT){
-				// Loss.
-				std::cout << "YOU LOSE!" << std::endl;
-				lastGameResult = 0;
-			} else if(getBlankedWord().find('_') == std::string::npos){
-				// Win.
-				std::cout << "YOU WIN!" << std::endl;
-				alert = "You win! The word was '" + word + "'.";
-				lastGameResult = 1;
-			}
+void Game::finishRound(){
+	// TODO: Bonus based on time.
+	// Mark win/loss.
+	std::lock_guard<std::mutex> lock(gameMutex);
+	const bool lost = (countIncorrectLocked() >= GUESS_LIMIT);
+	if(mode == MODE_COMPUTER_GUESSES_WORD){
+		std::cout << (lost ? "Computer loses!" : "Computer wins!") << std::endl;
+	} else {
+		std::cout << (lost ? "YOU LOSE!" : "YOU WIN!") << std::endl;
+	}
+	lastGameResult = (lost ? 0 : 1);
+	if(mode == MODE_COMPUTER_PICKS_WORD){
+		// Compute and apply score difference.
+		score += computeScoreChange((bool)lastGameResult, level);
 
-			// Compute and apply score difference.
-			int score_diff = computeScoreChange((bool)lastGameResult, level);
-			score += score_diff;
-
-			// Compute and apply level difference.
-			levelDiff = 0;
-			if(lastGameResult == 0){
-				// Loss.
-				if(level > 1) levelDiff = -1;
-			} else if(lastGameResult == 1){
-				// Win.
-				if(level < NUM_LEVELS) levelDiff = 1;
-			}
-			level = (unsigned int)((int)level + levelDiff);
+		// Compute and apply level difference.
+		levelDiff = 0;
+		if(lost){
+			if(level > 1) levelDiff = -1;
+		} else {
+			if(level < NUM_LEVELS) levelDiff = 1;
+		}
+		level = (unsigned int)((int)level + levelDiff);
+	}
 
-			// Broadcast win/loss.
-			if(lastGameResult == 0){
+	// Broadcast win/loss.
+	switch(mode){
+		case MODE_COMPUTER_PICKS_WORD:
+			if(lost){
 				alert = "You lost! ";
 				if(levelDiff < 0) alert += "Level down! ";
 			} else {
@@ -696,122 +866,54 @@ void Game::start_game(unsigned int theLevel, GameMode theMode){
 				if(levelDiff > 0) alert += "Level up! ";
 			}
 			alert += "The word was '" + word + "'.";
-
-			// Show result screen.
-			std::string img = getCurrentGameImage(/*result_screen=*/true);
-			showPicture(img);
-
-			// Delay before starting next round.
-			std::cerr << "Delaying...\n";
-			flashDelay = true;
-			sleep(5);
-			std::cerr << "Starting next round.\n";
-			flashDelay = false;
-			++gameInd;
-		}
-		while(mode == MODE_USER_PICKS_WORD){
-			// Reset everything, waiting for the user to pick the word.
-			levelDiff = 0;
-			score = -1e9; // signifies N/A
-			gameMutex.lock();
-			word = ""; // clear word
-			alert = ""; // clear alerts
-			guessed.clear(); // clear guessed letters
-			lastGameResult = -1; // set game to ongoing state
-			gameMutex.unlock();
-
-			// Mark the time. //
-			auto now = std::chrono::system_clock::now();
-			auto duration = now.time_since_epoch();
-			auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
-
-			// Prompt the user for a word.
-			// TODO: Have alerts/server broadcasts have a "timestamp" field, and provide a macro language
-			// to embed constructs such as timers counting down to a specified unix time (e.g. for flash delay
-			// between rounds).
-
-			gameMutex.lock();
-			waitingForWord = true;
-			gameMutex.unlock();
-
-			// Loop, updating the game image each time.
-			while(waitingForWord || (getIncorrectGuessesNum() < GUESS_LIMIT && getBlankedWord().find('_') != std::string::npos)){
-				// Generate the current game image and display it.
-				std::string img = getCurrentGameImage();
-				std::ofstream ofp("out.jpeg", std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
-				ofp.write(img.c_str(), img.length());
-				ofp.close();
-				showPicture(img);
-
-				// Sleep so as not to create a busy loop. //
-				sleep(1);
-			}
-
-			// TODO: Flash result on screen for specified amount of time + broadcast to connected devices.
-			// TODO: Bonus based on time.
-			// Mark win/loss.
-			if(getIncorrectGuessesNum() >= GUESS_LIMIT){
-				// Loss.
-				std::cout << "YOU LOSE!" << std::endl;
-				lastGameResult = 0;
-			} else if(getBlankedWord().find('_') == std::string::npos){
-				// Win.
-				std::cout << "YOU WIN!" << std::endl;
-				alert = "You win! The word was '" + word + "'.";
-				lastGameResult = 1;
-			}
-
-			// Broadcast win/loss.
-			if(lastGameResult == 0){
-				alert = "You lost! ";
-			} else {
-				alert = "You win! ";
-			}
+			break;
+		case MODE_USER_PICKS_WORD:
+			alert = (lost ? "You lost! " : "You win! ");
 			alert += "The word was '" + word + "'.";
+			break;
+		case MODE_COMPUTER_GUESSES_WORD:
+			alert = (lost ? "Computer lost!" : "Computer won!");
+			alert += " The word was '" + word + "'.";
+			break;
+	}
 
-			// Show result screen.
-			std::string img = getCurrentGameImage(/*result_screen=*/true);
-			showPicture(img);
-
-			// Delay before starting next round.
-			std::cerr << "Delaying...\n";
-			flashDelay = true;
-			sleep(5);
-			std::cerr << "Starting next round.\n";
-			flashDelay = false;
-			++gameInd;
-		}
-		while(mode == MODE_COMPUTER_GUESSES_WORD){
-			// Reset everything, waiting for the user to pick the word.
-			levelDiff = 0;
-			wordLength = 0U;
-			score = -1e9; // signifies N/A
-			gameMutex.lock();
-			word = ""; // clear word
-			alert = ""; // clear alerts
-			guessed.clear(); // clear guessed letters
-			lastGameResult = -1; // set game to ongoing state
-			guessValidity.clear(); // clear guesses
-			gameMutex.unlock();
+	// The result screen stays up until the next round.
+	flashDelay = true;
+	acceptingGuesses = false;
+	updateGuessStateLocked();
+	publishLocked();
+}
 
-			// Mark the time. //
-			auto now = std::chrono::system_clock::now();
-			auto duration = now.time_since_epoch();
-			auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+GameStep Game::step(){
+	switch(state){
+		case STATE_NEW_ROUND:
+			beginRound();
+			return GameStep::next();
 
-			// Prompt the user for the number of letters.
-			gameMutex.lock();
-			std::cerr << "Random word: " << list.getWordAtLevel(rand() % NUM_LEVELS + 1) << std::endl;
-			// %prompt(Title, /url, variable_name_in_url, Label, Type ("text"|"number"))
-			alert = "%prompt(Number of letters in word, /setWordLength, length, Length, number)";
-			gameMutex.unlock();
-			while(wordLength == 0U) usleep(500);
-			gameMutex.lock();
+		case STATE_WAITING_FOR_LENGTH: {
+			std::lock_guard<std::mutex> lock(gameMutex);
+			if(wordLength == 0U) return GameStep::waitForEvent();
 			alert = "";
-			word = std::string(wordLength, '_');
-			gameMutex.unlock();
+			setWordLocked(std::string(wordLength, '_'));
+			// Nothing guessed yet: every word of this length is a candidate.
+			const size_t count = list->ranksOfLengthEnd(wordLength) - list->ranksOfLengthBegin(wordLength);
+			candidates.assign(list->getBitsetRowWords(wordLength), 0ULL);
+			std::fill(candidates.begin(), candidates.begin() + count / 64, ~0ULL);
+			if(count % 64) candidates[count / 64] = (1ULL << (count % 64)) - 1;
+			state = STATE_COMPUTER_GUESSING;
+			return GameStep::next();
+		}
+
+		case STATE_PLAYING:
+			// Show the current game image, then sleep until somebody does something.
+			if(roundInProgress()){
+				presentFrame();
+				return GameStep::waitForEvent();
+			}
+			state = STATE_ROUND_OVER;
+			return GameStep::next();
 
-			// Loop, updating the game image each time.
+		case STATE_COMPUTER_GUESSING: {
 			/*
 			* Guessing Algorithm:
 			* 1. Generate a subset of the wordlist that matches the recorded constraints.
@@ -824,71 +926,160 @@ void Game::start_game(unsigned int theLevel, GameMode theMode){
 			*	- e.g. In above example, we would guess "x" with a probability of 100% of being
 			*		   on the blank, versus taking a 50-50 chance with "y" or "c".
 			*/
-			while(getIncorrectGuessesNum() < GUESS_LIMIT && getBlankedWord().find('_') != std::string::npos){
-				// Generate the current game image and display it.
-				/*
-				// TODO: enable & implement later
-				std::string img = getCurrentGameImage();
-				std::ofstream ofp("out.jpeg", std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
-				ofp.write(img.c_str(), img.length());
-				ofp.close();
-				showPicture(img);
-				*/
-
-				// Decide which letter to guess. //
-				char guessingLetter = nextLetterToGuess();
-
-				// Send the letter to the user to affirm/deny. //
-				gameMutex.lock();
-				lastComputerGuess = guessingLetter;
-				std::stringstream fmt;
-				fmt << "%prompt(Computer Guesses: " << (char)toupper(lastComputerGuess) << ", /setLetterInWord, in_word, Is ";
-				fmt << (char)toupper(lastComputerGuess) << " In Your Word?, choice)";
-				alert = fmt.str();
-				gameMutex.unlock();
-
-				// Wait for the user's response. //
-				while(lastComputerGuess != '\0') usleep(500);
+			if(!roundInProgress()){
+				std::lock_guard<std::mutex> lock(gameMutex);
+				if(!wordSolvedLocked()){
+					// Ask the user what the word actually was if we didn't guess it. //
+					alert = "%prompt(Out of Guesses, /setActualWord, word, What was your word?, text)";
+					waitingForActualWord = true;
+					state = STATE_WAITING_FOR_ACTUAL_WORD;
+					return GameStep::waitForEvent();
+				}
+				state = STATE_ROUND_OVER;
+				return GameStep::next();
 			}
 
-			// Ask the user what the word actually was if we didn't guess it. //
-			if(getBlankedWord().find('_') != std::string::npos){
-				gameMutex.lock();
-				alert = "%prompt(Out of Guesses, /setActualWord, word, What was your word?, text)";
-				gameMutex.unlock();
-				while(true) usleep(500);
-			}
+			// Decide which letter to guess. //
+			char guessingLetter = nextLetterToGuess();
 
-			// TODO: Bonus based on time.
-			// Mark win/loss.
-			if(getIncorrectGuessesNum() >= GUESS_LIMIT){
-				// User wins.
-				std::cout << "Computer loses!" << std::endl;
-				lastGameResult = 0;
-			} else if(getBlankedWord().find('_') == std::string::npos){
-				// User loses.
-				std::cout << "Computer wins!" << std::endl;
-				lastGameResult = 1;
-			}
+			// Send the letter to the user to affirm/deny. //
+			std::lock_guard<std::mutex> lock(gameMutex);
+			lastComputerGuess = guessingLetter;
+			std::stringstream fmt;
+			fmt << "%prompt(Computer Guesses: " << (char)toupper(lastComputerGuess) << ", /setLetterInWord, in_word, Is ";
+			fmt << (char)toupper(lastComputerGuess) << " In Your Word?, choice)";
+			alert = fmt.str();
+			state = STATE_WAITING_FOR_ANSWER;
+			return GameStep::waitForEvent();
+		}
 
-			// Broadcast win/loss.
-			if(lastGameResult == 0){
-				alert = "Computer lost!";
-			} else {
-				alert = "Computer won! The word was '" + word + "'.";
-			}
+		case STATE_WAITING_FOR_ANSWER: {
+			// Wait for the user's response. //
+			std::lock_guard<std::mutex> lock(gameMutex);
+			if(lastComputerGuess != '\0') return GameStep::waitForEvent();
+			state = STATE_COMPUTER_GUESSING;
+			return GameStep::next();
+		}
+
+		case STATE_WAITING_FOR_ACTUAL_WORD: {
+			std::lock_guard<std::mutex> lock(gameMutex);
+			if(waitingForActualWord) return GameStep::waitForEvent();
+			state = STATE_ROUND_OVER;
+			return GameStep::next();
+		}
 
-			// Show result screen.
-			std::string img = getCurrentGameImage(/*result_screen=*/true);
-			showPicture(img);
+		case STATE_ROUND_OVER:
+			finishRound();
 
-			// Delay before starting next round.
+			// Show result screen, then hold it before starting the next round.
+			presentFrame(/*result_screen=*/true);
 			std::cerr << "Delaying...\n";
-			flashDelay = true;
-			sleep(5);
+			state = STATE_FLASH_DELAY;
+			return GameStep::after(FLASH_DELAY_MS);
+
+		case STATE_FLASH_DELAY:
 			std::cerr << "Starting next round.\n";
+			gameMutex.lock();
 			flashDelay = false;
 			++gameInd;
+			gameMutex.unlock();
+			state = STATE_NEW_ROUND;
+			return GameStep::next();
+	}
+	return GameStep::next();
+}
+
+void Game::signalEventLocked(){
+	publishLocked();
+	++eventSeq;
+	gameEvent.notify_all();
+	if(parked){
+		parked = false;
+		scheduler->post([this]{ resume(); });
+	}
+}
+
+void Game::resume(){
+	// Same loop as start_game, except that instead of sleeping the rest of the round is
+	// handed back to the scheduler: a timer for delays, or signalEventLocked for input.
+	while(true){
+		gameMutex.lock();
+		unsigned long long seen = eventSeq;
+		gameMutex.unlock();
+		GameStep next = step();
+		publish();
+		if(next.delayMs > 0){
+			scheduler->postAfter(next.delayMs, [this]{ resume(); });
+			return;
+		}
+		if(next.wait){
+			std::lock_guard<std::mutex> lock(gameMutex);
+			if(eventSeq == seen){
+				parked = true;
+				return;
+			}
+		}
+	}
+}
+
+void Game::schedule(Scheduler& s, unsigned int theLevel, GameMode theMode){
+	this->level = theLevel;
+	this->mode = theMode;
+	state = STATE_NEW_ROUND;
+	publish();
+	scheduler = &s;
+	assets->loadInBackground();
+	awaitAssets();
+}
+
+void Game::awaitAssets(){
+	// Check back on a timer instead of waiting in load(): every room created during startup
+	// would otherwise hold a worker until the assets are in, and a few could hold them all.
+	if(!isReady()){
+		scheduler->postAfter(ASSETS_POLL_MS, [this]{ awaitAssets(); });
+		return;
+	}
+	scheduler->post([this]{
+		load(); // returns at once now; picks up the wordlist
+		resume();
+	});
+}
+
+void Game::start_game(unsigned int theLevel, GameMode theMode){
+	/*
+	* Modes:
+	* 1. Computer picks a word at a specified level, and user guesses.
+	* 	- Extension: Collaborative guessing, word suggestions, over wireless/HTTP server - CHECK.
+	* 	- Extension: Every time the user guesses something correctly, the computer tries to alter the word
+	* 	  instead and find another possibility that fits with the restrictions (length, guessed, etc.)
+	* 	  imposed so far, making it much, much harder - TODO.
+	* 2. User thinks of a word at a specified level, and computer guesses.
+	* 3. User thinks of a word while other users try to guess it, and computer is an arbiter and a screen.
+	*/
+
+	// Finish loading if nobody did it yet.
+	load();
+
+	// Instantiate necessary variables.
+	this->level = theLevel;
+	this->mode = theMode;
+	state = STATE_NEW_ROUND;
+	publish();
+
+	// Run the round state machine, sleeping on the event condition whenever it is blocked on input.
+	// The sequence number is sampled before each step so an event that arrives mid-step is not lost.
+	std::unique_lock<std::mutex> lock(gameMutex);
+	while(true){
+		unsigned long long seen = eventSeq;
+		lock.unlock();
+		GameStep next = step();
+		publish();
+		if(next.delayMs > 0){
+			std::this_thread::sleep_for(std::chrono::milliseconds(next.delayMs));
+		}
+		lock.lock();
+		if(next.wait){
+			gameEvent.wait(lock, [&]{ return eventSeq != seen; });
 		}
 	}
 }
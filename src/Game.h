@@ -1,6 +1,13 @@
 #ifndef GAME_INC
 #define GAME_INC
 #include "Words.h"
+#include "Snapshot.h"
+#include "Sink.h"
+#include "Assets.h"
+#include "Blit.h"
+#include "Scheduler.h"
+#include "Letters.h"
+#include "Random.h"
 #include <iostream>
 #include <iomanip>
 #include <stdexcept>
@@ -11,8 +18,66 @@
 #include <gdfontg.h>
 #include <sys/stat.h>
 #include <mutex>
+#include <condition_variable>
 #include <memory>
 #include <functional>
+#include <atomic>
+
+// Per-phase rendering cost, accumulated across calls to getCurrentGameImage (in microseconds).
+struct RenderProfile {
+	double layout = 0.0; // measuring text bounding boxes to size/position it
+	double composite = 0.0; // framebuffer setup, background/stage blits and shapes
+	double text = 0.0; // drawing text and keyboard crosses
+	double encode = 0.0; // JPEG encoding and copying out the result
+	unsigned long long frames = 0; // number of frames rendered
+};
+
+// How long the result screen stays up before the next round starts (in milliseconds).
+#define FLASH_DELAY_MS 5000
+#define ASSETS_POLL_MS 50 // how often a scheduled game checks whether the shared assets have loaded
+
+// Where a game is within its round; start_game advances it one step at a time.
+enum GameState {
+	STATE_NEW_ROUND = 0, // reset and set up the next round for the current mode
+	STATE_WAITING_FOR_LENGTH, // computer guesses: waiting for the user to give the word length
+	STATE_PLAYING, // users guessing (or picking the word), frame shown on each change
+	STATE_COMPUTER_GUESSING, // computer guesses: pick the next letter
+	STATE_WAITING_FOR_ANSWER, // computer guesses: waiting for the user to confirm/deny the letter
+	STATE_WAITING_FOR_ACTUAL_WORD, // computer guesses: out of guesses, waiting for the user to reveal the word
+	STATE_ROUND_OVER, // score the round and show the result screen
+	STATE_FLASH_DELAY // result screen is up, next round starts when the delay is over
+};
+
+// What the game loop should do after a step.
+struct GameStep {
+	bool wait; // sleep until the next external event
+	unsigned int delayMs; // sleep for this long first
+	static GameStep next(){ return GameStep{false, 0}; }
+	static GameStep waitForEvent(){ return GameStep{true, 0}; }
+	static GameStep after(unsigned int ms){ return GameStep{false, ms}; }
+};
+
+// Outcome of a guess from a player.
+enum GuessStatus {
+	GUESS_CORRECT = 0, // letter is in the word
+	GUESS_INCORRECT, // letter is not in the word
+	GUESS_INVALID_LETTER, // not a lowercase letter
+	GUESS_ALREADY_GUESSED, // someone got there first
+	GUESS_NO_GUESSES_LEFT, // all GUESS_LIMIT incorrect guesses are used up
+	GUESS_NOT_PLAYING // no round is accepting guesses right now
+};
+
+struct GuessResult {
+	GuessStatus status = GUESS_NOT_PLAYING;
+	unsigned int instances = 0; // occurrences of the letter in the word
+};
+
+// Layout of Game::guessState, which holds everything needed to validate a guess so that it can be
+// checked and applied with a single compare-and-swap.
+#define GUESS_STATE_CORRECT_SHIFT 26 // bits 0-25: guessed letters; 26-52: letters known to be in the word (LetterMask)
+#define GUESS_STATE_OPEN ((uint64_t)1 << 53) // the round accepts guesses
+#define GUESS_STATE_EPOCH_SHIFT 54 // bits 54-63: round number, so a stale guess can't land in a new round
+#define GUESS_STATE_EPOCH_MASK ((uint64_t)0x3FF)
 
 enum GameMode {
 	MODE_COMPUTER_PICKS_WORD = 0, // computer picks word, user(s) guess
@@ -20,73 +85,157 @@ enum GameMode {
 	MODE_COMPUTER_GUESSES_WORD // user picks word, computer guesses
 };
 
+// Immutable copy of everything readers need, published by the game after every change.
+// HTTP handlers and the renderer read one of these instead of taking gameMutex, so they
+// always see a consistent state and never hold up the game or each other.
+struct GameSnapshot {
+	GameMode mode = MODE_COMPUTER_PICKS_WORD;
+	unsigned int level = 0;
+	int levelDiff = 0;
+	int score = 0;
+	unsigned int gameInd = 0;
+	int lastGameResult = -1;
+	bool flashDelay = false;
+	bool waitingForWord = false;
+	bool allowAnyWord = false;
+	std::string word;
+	long wordRank = -1; // rank of word in the wordlist (-1 if not in it)
+	uint32_t wordCount = 0; // words in the round's wordlist
+	std::string blankedWord; // as returned by getBlankedWord
+	LetterMask guessed = 0; // letters guessed so far
+	LetterMask incorrect = 0; // guesses that were wrong
+	std::string alert;
+	unsigned long long version = 0; // incremented on every publish
+};
+
 class Game {
 	private:
 		// Private use.
-		Wordlist list; // wordlist
-		airplay_device& conn; // airplay connection
-		gdImagePtr background; // background image
+		FrameSink* sink; // where frames are shown (nullptr = render only, e.g. for benchmarks)
+		std::shared_ptr<GameAssets> assets; // wordlist, images and render caches shared with other games
+		std::string textBuf, auxBuf; // reusable text buffers for rendering
+		RenderProfile* profile = nullptr; // optional render cost accounting
+		uint64_t lastSentHash = 0; // render-input hash of the last frame shown
+		bool sentAny = false; // whether lastSentHash is valid
+		SnapshotWriter* snapshots = nullptr; // optional debug sink for rendered frames
 		
 		// Other threads allowed access, must be thread-safe.
 		std::mutex gameMutex; // mutex for protecting variables
+		// Latest snapshot; use atomic_load/atomic_store only. These are not lock-free: libstdc++
+		// and libc++ guard them with a small pool of locks hashed by address, held for the
+		// pointer copy only, so readers never wait on gameMutex or on each other's work.
+		// (Deprecated in C++20, where std::atomic<std::shared_ptr> replaces them.)
+		std::shared_ptr<const GameSnapshot> published;
+		std::condition_variable gameEvent; // signalled (under gameMutex) whenever a handler changes the game
+		unsigned long long eventSeq = 0; // bumped on every event, so the game loop can't miss one
 		unsigned int level; // level of game
 		int levelDiff; // change in level based on result
 		GameMode mode; // game mode
+		std::shared_ptr<const Wordlist> list; // wordlist of the current round, taken from assets when it begins
 		std::string word; // chosen word
+		long wordRank = -1; // rank of word in the wordlist (-1 if not in it), looked up once by setWordLocked
 		unsigned int wordLength; // for use with computer guessing word
-		std::vector<char> guessed; // guessed letters
+		std::atomic<uint64_t> guessState{0}; // guessed letters and guessing rules, packed (see GUESS_STATE_*); written under gameMutex or by guessLetter's CAS
+		bool acceptingGuesses = false; // whether players may guess in the current round
+		LetterMask wordMask = 0; // letters in word (plus LETTER_MASK_OTHER for blanks), kept in sync by setWordLocked
 		std::string alert; // any broadcasts for clients
 		unsigned int gameInd = 0; // index of game
 		int score = 0; // game score
 		int lastGameResult = -1; // result of last game (-1 = ongoing/TBD, 0 = lost, 1 = won)
 		bool flashDelay = false; // whether we are in the period after a round ended, before the next
 		bool waitingForWord = false; // if we are waiting on the user for a word
+		bool allowAnyWord = false; // whether chooseWord accepts words that are not in the wordlist
+		bool waitingForActualWord = false; // if the computer ran out of guesses and wants to know the word
 		char lastComputerGuess = '\0'; // the last guess by the computer of a letter
-		std::map<char, bool> guessValidity; // for computer guesses - map [letter guessed] --> [correct guess or not]
+		LetterMask confirmed = 0; // for computer guesses - guessed letters the user confirmed are in the word
+		std::vector<uint64_t> candidates; // for computer guesses - bit row (see Wordlist::wordsWithLetter) of the words that still fit every answer
 		
 		// Helper methods.
 		std::string getCurrentGameImage(bool result_screen = false); // generate image for airplay
-		void showPicture(std::string& data); // send image over airplay
+		std::string getFrameKey(const GameSnapshot& state, bool result_screen); // serialize everything renderGameImage depends on
+		void presentFrame(bool result_screen = false); // render (or reuse) the current frame and show it if it changed
+		bool showPicture(std::shared_ptr<const std::string> data); // send image to the frame sink
 		int computeScoreChange(bool won, unsigned int level); // compute score change
 		char nextLetterToGuess(); // figure out the next letter to guess
+		
+		// State queries for the game itself (caller holds gameMutex).
+		LetterMask incorrectMaskLocked(); // incorrect guesses
+		unsigned int countIncorrectLocked(); // number of incorrect guesses
+		void blankWordLocked(std::string& out); // word with unguessed letters as '_', space-separated
+		bool wordSolvedLocked(); // every letter of the word has been guessed
+		void setWordLocked(const std::string& w); // change the word (and wordMask and wordRank)
+		void narrowCandidatesLocked(char letter); // drop the candidates that no longer fit word, once letter is answered
+		void updateGuessStateLocked(LetterMask add = 0); // refresh guessState from the fields above, adding guessed letters
+		void resetGuessesLocked(); // clear guessed letters and start a new guessing epoch
+		LetterMask guessedMask(){ return (LetterMask)guessState.load() & LETTER_MASK_ALL; } // guessed letters
+		void publishLocked(); // publish a snapshot of the current state
+		void publish(); // publishLocked, taking gameMutex
+		
+		// Round state machine (only touched by the thread running the game).
+		GameState state = STATE_NEW_ROUND; // current step of the round
+		GameStep step(); // advance the round as far as it can go without input
+		void beginRound(); // reset for a new round in the current mode
+		void finishRound(); // mark win/loss, apply score/level changes and set the result alert
+		bool roundInProgress(); // whether the current round is still being played
+		void signalEventLocked(); // wake the game loop; caller holds gameMutex
+		Scheduler* scheduler = nullptr; // runs the round when started with schedule() (nullptr under start_game)
+		bool parked = false; // blocked on input with no continuation queued; protected by gameMutex
+		void resume(); // scheduler continuation: run steps until blocked, then hand the rest back
+		void awaitAssets(); // start the first round once the assets are loaded, without blocking a worker
+		FastRandom rng; // this game's engine, so seeded runs replay room by room
+		ShuffleBag levelBags[NUM_LEVELS]; // ranks of each level's words, so a word only comes back once its level is used up
+		std::string drawWordLocked(unsigned int level); // next word from the level's bag
 	public:
-		Game(airplay_device& conn);
+		Game(FrameSink* sink, std::shared_ptr<GameAssets> assets);
 		~Game(){ }
 		
 		// Main methods. //
-		int guessLetter(char letter); // guesses the letter, returns number of instances of letter in word
-		void start_game(unsigned int level = 15, GameMode mode = MODE_COMPUTER_PICKS_WORD); // start the game
+		void load(); // load the shared assets if nobody did yet; start_game calls this
+		bool isReady(){ return assets->isReady(); } // whether the shared assets are loaded
+		GuessResult guessLetter(char letter); // validate and apply a guess atomically
+		void start_game(unsigned int level = 15, GameMode mode = MODE_COMPUTER_PICKS_WORD); // run the game on the calling thread, forever
+		void schedule(Scheduler& s, unsigned int level = 15, GameMode mode = MODE_COMPUTER_PICKS_WORD); // run the game as continuations on a shared scheduler
+		bool renderGameImage(const GameSnapshot& state, bool result_screen, std::string& out); // render any snapshot into out (JPEG) without showing it
 		
 		// Accessor methods. //
+		// Debug snapshots (nullptr disables them).
+		void setSnapshotWriter(SnapshotWriter* writer){ snapshots = writer; }
+		// Render profiling (nullptr disables it).
+		void setRenderProfile(RenderProfile* p){ profile = p; }
 		// For the mutex.
 		std::mutex& getLock(){ return gameMutex; }
+		// Consistent view of the whole state; the accessors below each read the latest one.
+		std::shared_ptr<const GameSnapshot> getSnapshot(){ return std::atomic_load(&published); }
 		// Level & score.
-		unsigned int getLevel(){ return level; }
-		int getScore(){ return score; }
+		unsigned int getLevel(){ return getSnapshot()->level; }
+		int getScore(){ return getSnapshot()->score; }
 		// Guesses (and information about them).
-		unsigned int getGuessesNum(){ return guessed.size(); } // get number of guesses
-		std::vector<char> getGuessedLetters(){ return guessed; } // get all guesses
-		unsigned int getIncorrectGuessesNum(); // get number of incorrect guesses
-		std::vector<char> getIncorrectGuesses(); // get all incorrect guesses
+		unsigned int getGuessesNum(){ return countLetters(getSnapshot()->guessed); } // get number of guesses
+		std::vector<char> getGuessedLetters(){ return maskLetters(getSnapshot()->guessed); } // get all guesses
+		unsigned int getIncorrectGuessesNum(){ return countLetters(getSnapshot()->incorrect); } // get number of incorrect guesses
+		std::vector<char> getIncorrectGuesses(){ return maskLetters(getSnapshot()->incorrect); } // get all incorrect guesses
 		// Game index & result.
-		unsigned int getGameIndex(){ return gameInd; } // get game index #
-		int getLastGameResult(){ return lastGameResult; } // get last game result
+		unsigned int getGameIndex(){ return getSnapshot()->gameInd; } // get game index #
+		int getLastGameResult(){ return getSnapshot()->lastGameResult; } // get last game result
 		// Game information.
-		GameMode getMode(){ return mode; }
-		bool inFlashDelay(){ return flashDelay; }
-		bool isWaitingForWord(){ return waitingForWord; }
+		GameMode getMode(){ return getSnapshot()->mode; }
+		bool inFlashDelay(){ return getSnapshot()->flashDelay; }
+		bool isWaitingForWord(){ return getSnapshot()->waitingForWord; }
+		bool allowsAnyWord(){ return getSnapshot()->allowAnyWord; }
 		// Externally-Triggered Actions.
 		std::string chooseWord(std::string word); // user chooses word - returns error message
 		std::string chooseLength(int length); // user provides word length - returns error message
 		std::string saveGuessResult(std::string result); // result of last guess by computer
 		std::string saveWordLocations(std::string word); // save user-provided word locations
+		std::string saveActualWord(std::string word); // user reveals the word the computer failed to guess
+		void setAllowAnyWord(bool allow); // let this room choose words that are not in the wordlist (operator setting: startup default or a local POST)
 		// Word information.
-		unsigned int getWordLength(){ return word.length(); }
-		std::string getWord(){ return word; }
-		std::string getBlankedWord(); // get correctly blanked word based on guesses
+		unsigned int getWordLength(){ return getSnapshot()->word.length(); }
+		std::string getWord(){ return getSnapshot()->word; }
+		std::string getBlankedWord(){ return getSnapshot()->blankedWord; } // get correctly blanked word based on guesses
 		std::string getWordHTMLForm(); // get form version of word
 		// Alerts.
-		std::string getLatestAlert(){ return alert; }
+		std::string getLatestAlert(){ return getSnapshot()->alert; }
 };
 
 #endif
@@ -0,0 +1,45 @@
+#ifndef LETTERS_INC
+#define LETTERS_INC
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Sets of letters as bitmasks: bit i is letter 'a' + i. Bit 26 marks "something that is not
+// a letter" (e.g. the '_' of an unknown position), so a word containing one can never be
+// fully guessed. Guessing state, blanking and scoring become a few bit operations, and a
+// mask is also a compact key for caching and for sending over the wire.
+typedef uint32_t LetterMask;
+
+#define LETTER_MASK_ALL ((LetterMask)0x3FFFFFF) // 'a' to 'z'
+#define LETTER_MASK_OTHER ((LetterMask)1 << 26) // any non-letter
+#define LETTER_MASK_VOWELS ((LetterMask)0x104111) // a, e, i, o, u
+
+// Bit of a lowercase letter, or 0 for anything else.
+inline LetterMask letterBit(char c){
+	return (c >= 'a' && c <= 'z') ? ((LetterMask)1 << (c - 'a')) : 0;
+}
+
+// Letters that appear in a word (LETTER_MASK_OTHER if it contains anything else).
+inline LetterMask wordLetterMask(const std::string& word){
+	LetterMask mask = 0;
+	for(char c : word){
+		LetterMask bit = letterBit(c);
+		mask |= (bit ? bit : LETTER_MASK_OTHER);
+	}
+	return mask;
+}
+
+inline unsigned int countLetters(LetterMask mask){
+	return (unsigned int)__builtin_popcount(mask & LETTER_MASK_ALL);
+}
+
+// Letters of a mask in alphabetical order.
+inline std::vector<char> maskLetters(LetterMask mask){
+	std::vector<char> ret;
+	for(char c = 'a'; c <= 'z'; c++){
+		if(mask & letterBit(c)) ret.push_back(c);
+	}
+	return ret;
+}
+
+#endif
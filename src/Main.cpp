@@ -1,6 +1,13 @@
 #include "Words.h"
 #include "Game.h"
 #include "Server.h"
+#include "Rooms.h"
+#include "Receiver.h"
+#include "Broadcast.h"
+#include "Discovery.h"
+#include "Startup.h"
+#include "Random.h"
+#include <csignal>
 
 #define ASSERT(x, m) if(!(x)){ fprintf(stderr, m "\n"); ::exit(1); }
 #define MAP_ITEM(r) {r, #r}
@@ -9,6 +16,14 @@ std::string SERVER_HOST = "127.0.0.1";
 unsigned int SERVER_PORT = 8001;
 unsigned int LEVEL = 1;
 GameMode GAME_MODE = MODE_COMPUTER_PICKS_WORD;
+std::string SNAPSHOT_PATH = ""; // empty = debug snapshots disabled
+unsigned int SNAPSHOT_INTERVAL_MS = 1000;
+unsigned int SNAPSHOT_HISTORY = 0;
+int RECEIVER_PORT = -1; // -1 = use a real Airplay device
+std::string RECEIVER_LOG = "";
+unsigned int GAME_WORKERS = SCHEDULER_WORKERS;
+bool ALLOW_ANY_WORD = false;
+unsigned int WATCH_WORDLIST_MS = 0; // 0 = only reload through POST /reloadWordlist
 
 const std::map<GameMode, std::string> MODE_DESCRIPTORS = {
 	{MODE_COMPUTER_PICKS_WORD, "MODE_COMPUTER_PICKS_WORD"}
@@ -16,12 +31,24 @@ const std::map<GameMode, std::string> MODE_DESCRIPTORS = {
 
 int help(int argc, char** argv){
 	fprintf(stderr, "%s [-h/--help] [-m/--mode (0-2)] [-p/--port (PORT)] [-h/--host (HOST)] [-l/--level (LEVEL)]\n", argv[0]);
+	fprintf(stderr, "\t[-d/--debug-snapshot (PATH)] [--snapshot-interval (MS)] [--snapshot-history (N)]\n");
+	fprintf(stderr, "\t[-r/--receiver (PORT)] [--receiver-log (PATH)] [-w/--workers (N)] [--seed (N)]\n");
+	fprintf(stderr, "\t[--watch-wordlist (MS)] [--allow-any-word]\n");
+	fprintf(stderr, "-r/--receiver runs a local stand-in Airplay receiver on PORT and sends frames to it instead of a device.\n");
+	fprintf(stderr, "-w/--workers sets how many threads run the games of every room (default %u).\n", GAME_WORKERS);
+	fprintf(stderr, "--watch-wordlist checks the wordlist files every MS milliseconds and reloads them when they change\n");
+	fprintf(stderr, "\t(POST /reloadWordlist from this machine reloads them on demand either way).\n");
+	fprintf(stderr, "--allow-any-word lets players choose words that are not in the wordlist, in every new room\n");
+	fprintf(stderr, "\t(POST /room/<id>/setAllowAnyWord?allow=0/1 from this machine changes it per room).\n");
+	fprintf(stderr, "--seed makes word picks reproducible: the same seed and the same moves give the same words.\n");
 	fprintf(stderr, "Port is set to %u; host is set to %s; level is set to %d\n", SERVER_PORT, SERVER_HOST.c_str(), LEVEL);
 	fprintf(stderr, "Modes:\n\t0 = MODE_COMPUTER_PICKS_WORD\n\t1 = MODE_USER_PICKS_WORD\n\t2 = MODE_COMPUTER_GUESSES_WORD\n");
 	return 0;
 }
 
 int main(int argc, char** argv){
+	startupBegin();
+
 	// Parse command-line arguments.
 	if(argc == 1){
 		return help(argc, argv);
@@ -42,28 +69,74 @@ int main(int argc, char** argv){
 		} else if(on == "-l" || on == "--level"){
 			ASSERT((i + 1) < argc, "Not enough arguments to -l/--level");
 			LEVEL = atoi(argv[i + 1]);
+		} else if(on == "-d" || on == "--debug-snapshot"){
+			ASSERT((i + 1) < argc, "Not enough arguments to -d/--debug-snapshot");
+			SNAPSHOT_PATH = std::string(argv[i + 1]);
+		} else if(on == "--snapshot-interval"){
+			ASSERT((i + 1) < argc, "Not enough arguments to --snapshot-interval");
+			SNAPSHOT_INTERVAL_MS = atoi(argv[i + 1]);
+		} else if(on == "--snapshot-history"){
+			ASSERT((i + 1) < argc, "Not enough arguments to --snapshot-history");
+			SNAPSHOT_HISTORY = atoi(argv[i + 1]);
+		} else if(on == "-r" || on == "--receiver"){
+			ASSERT((i + 1) < argc, "Not enough arguments to -r/--receiver");
+			RECEIVER_PORT = atoi(argv[i + 1]);
+		} else if(on == "--receiver-log"){
+			ASSERT((i + 1) < argc, "Not enough arguments to --receiver-log");
+			RECEIVER_LOG = std::string(argv[i + 1]);
+		} else if(on == "-w" || on == "--workers"){
+			ASSERT((i + 1) < argc, "Not enough arguments to -w/--workers");
+			GAME_WORKERS = atoi(argv[i + 1]);
+		} else if(on == "--seed"){
+			ASSERT((i + 1) < argc, "Not enough arguments to --seed");
+			seedRandom(strtoull(argv[i + 1], NULL, 10));
+		} else if(on == "--allow-any-word"){
+			ALLOW_ANY_WORD = true;
+		} else if(on == "--watch-wordlist"){
+			ASSERT((i + 1) < argc, "Not enough arguments to --watch-wordlist");
+			WATCH_WORDLIST_MS = atoi(argv[i + 1]);
 		}
 	}
 	printf("Host: %s | Port: %u | Mode: %d\n", SERVER_HOST.c_str(), SERVER_PORT, GAME_MODE);
 
-	// Search for Airplay-compatible devices and select the first one.
-	const auto devices = airplay_browser::get_devices();
-	unsigned int num_discovered = devices.size();
-	printf("Discovered %u device(s).\n", num_discovered);
-	airplay_device conn(devices.begin()->second);
-	printf("Sending message...");
-	conn.send_message(MessageType::GetServices);
-	printf("done!\n");
+	// A client or receiver that hangs up mid-write must fail that write (EPIPE), not kill the server.
+	signal(SIGPIPE, SIG_IGN);
 
 	// Initialize thread pool.
 	std::vector<std::thread> threads;
 
-	// Start the game with the selected mode.
-	Game game(conn);
-	threads.push_back(std::thread(&Game::start_game, &game, /*level=*/LEVEL, /*mode=*/GAME_MODE));
+	// Pick where frames go: a local stand-in receiver, or every Airplay-compatible device that
+	// discovery finds, now or later. Nothing here waits for a device to show up.
+	BroadcastSink broadcast;
+	std::unique_ptr<LoopbackReceiver> receiver;
+	DeviceDiscovery discovery(broadcast);
+	if(RECEIVER_PORT >= 0){
+		receiver.reset(new LoopbackReceiver(RECEIVER_PORT, RECEIVER_LOG));
+		ASSERT(receiver->bind(), "Could not start the stand-in receiver");
+		threads.push_back(std::thread(&LoopbackReceiver::start, receiver.get()));
+		broadcast.addDevice("loopback", std::unique_ptr<FrameSink>(new HttpPhotoSink("127.0.0.1", RECEIVER_PORT)));
+	} else {
+		discovery.start();
+	}
+
+	// Startup runs as concurrent tasks: device discovery (above), loading the shared assets
+	// (wordlist and images, in parallel) followed by the game loops, and binding the web
+	// server, which answers with a "warming up" state until the assets are ready.
+	// The default room shows on the Airplay screens, mirroring frames to disk if requested;
+	// other rooms (/room/<id>/) are created on first use and share the same assets.
+	// Every room's rounds run as continuations on one scheduler, not a thread per room.
+	std::shared_ptr<GameAssets> assets = std::make_shared<GameAssets>();
+	Scheduler scheduler(GAME_WORKERS);
+	RoomRegistry rooms(assets, scheduler, LEVEL, GAME_MODE, ALLOW_ANY_WORD);
+	if(WATCH_WORDLIST_MS) assets->watchWordlist(scheduler, WATCH_WORDLIST_MS);
+	std::unique_ptr<SnapshotWriter> snapshots;
+	if(SNAPSHOT_PATH.length()){
+		snapshots.reset(new SnapshotWriter(SNAPSHOT_PATH, SNAPSHOT_INTERVAL_MS, SNAPSHOT_HISTORY));
+	}
+	rooms.addRoom(DEFAULT_ROOM, &broadcast, snapshots.get());
 
 	// Start the web server.
-	Server server(SERVER_HOST, SERVER_PORT, game);
+	Server server(SERVER_HOST, SERVER_PORT, rooms);
 	threads.push_back(std::thread(&Server::start, &server));
 
 	// Wait for threads to finish execution.
@@ -0,0 +1,75 @@
+#include "Random.h"
+#include <random>
+#include <atomic>
+
+static std::atomic<bool> seeded{false};
+static std::atomic<uint64_t> seedCounter{0};
+
+static inline uint64_t rotl(uint64_t x, int k){
+	return (x << k) | (x >> (64 - k));
+}
+
+// SplitMix64, to spread one seed over the engine's state.
+static inline uint64_t splitMix(uint64_t& x){
+	uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+FastRandom::FastRandom(uint64_t seed){
+	for(int i = 0; i < 4; i++) state[i] = splitMix(seed);
+}
+
+uint64_t FastRandom::next(){
+	const uint64_t result = rotl(state[1] * 5, 7) * 9;
+	const uint64_t t = state[1] << 17;
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = rotl(state[3], 45);
+	return result;
+}
+
+uint32_t FastRandom::below(uint32_t n){
+	// Multiply-shift rather than modulo; the bias is at most n / 2^32.
+	return (uint32_t)(((next() >> 32) * (uint64_t)n) >> 32);
+}
+
+void seedRandom(uint64_t seed){
+	seedCounter.store(seed);
+	seeded.store(true);
+}
+
+uint64_t nextRandomSeed(){
+	if(seeded.load()){
+		uint64_t x = seedCounter.fetch_add(1);
+		return splitMix(x);
+	}
+	std::random_device rd;
+	return ((uint64_t)rd() << 32) | rd();
+}
+
+FastRandom& threadRandom(){
+	thread_local FastRandom engine(nextRandomSeed());
+	return engine;
+}
+
+void ShuffleBag::reset(uint32_t b, uint32_t e){
+	begin = b;
+	end = e;
+	values.resize(e - b);
+	for(uint32_t i = 0; i < e - b; i++) values[i] = b + i;
+	remaining = (uint32_t)values.size();
+}
+
+uint32_t ShuffleBag::draw(FastRandom& rng){
+	// One step of a Fisher-Yates shuffle: move a random undrawn value to the end of the
+	// undrawn part and hand it out.
+	if(remaining == 0) remaining = (uint32_t)values.size();
+	uint32_t pick = rng.below(remaining);
+	std::swap(values[pick], values[remaining - 1]);
+	return values[--remaining];
+}
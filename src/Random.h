@@ -0,0 +1,38 @@
+#ifndef RANDOM_INC
+#define RANDOM_INC
+#include <vector>
+#include <cstdint>
+
+// Small, fast pseudo-random engine (xoshiro256**): 32 bytes of state and a few shifts per
+// draw, so it is cheap to keep one per thread and one per game. Not for anything secret.
+class FastRandom {
+	private:
+		uint64_t state[4];
+	public:
+		explicit FastRandom(uint64_t seed);
+		uint64_t next();
+		uint32_t below(uint32_t n); // uniform in [0, n); n > 0
+};
+
+// Seeds for new engines. Normally they come from std::random_device; after seedRandom(seed)
+// they are derived from seed in the order engines are created, so a run with the same seed
+// and the same sequence of events (benchmarks, replays) draws the same numbers.
+void seedRandom(uint64_t seed);
+uint64_t nextRandomSeed();
+
+FastRandom& threadRandom(); // this thread's engine, created on first use
+
+// Hands out every value of [begin, end) once, in random order, before repeating any, at
+// O(1) per draw. The order is reshuffled each time the bag runs out.
+class ShuffleBag {
+	private:
+		std::vector<uint32_t> values; // values[0 .. remaining) have not been drawn yet
+		uint32_t remaining = 0;
+		uint32_t begin = 0, end = 0;
+	public:
+		void reset(uint32_t begin, uint32_t end); // refill with [begin, end)
+		bool covers(uint32_t b, uint32_t e){ return begin == b && end == e; } // filled with [b, e)
+		uint32_t draw(FastRandom& rng); // next value; the range must not be empty
+};
+
+#endif
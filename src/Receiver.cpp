@@ -0,0 +1,116 @@
+#include "Receiver.h"
+#include "Sink.h"
+#include <iostream>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+LoopbackReceiver::LoopbackReceiver(int p, std::string logPath) : port(p), started(std::chrono::steady_clock::now()) {
+	if(logPath.length()){
+		log.open(logPath.c_str(), std::ofstream::out | std::ofstream::trunc);
+		if(!log.is_open()){
+			std::cerr << "Warning: Could not open '" << logPath << "' for logging frames." << std::endl;
+		} else {
+			log << "arrival_ms,bytes" << std::endl;
+		}
+	}
+}
+
+bool LoopbackReceiver::bind(){
+	sockfd = socket(AF_INET, SOCK_STREAM, 0);
+	if(sockfd < 0){
+		std::cerr << "Error creating receiver socket." << std::endl;
+		return false;
+	}
+	int flagVal = 1;
+	setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &flagVal, sizeof(flagVal));
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if(::bind(sockfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(sockfd, 16) < 0){
+		std::cerr << "Error: Could not bind stand-in receiver to port " << port << "." << std::endl;
+		::close(sockfd);
+		sockfd = -1;
+		return false;
+	}
+	std::cerr << "Stand-in receiver listening on 127.0.0.1:" << port << "..." << std::endl;
+	return true;
+}
+
+void LoopbackReceiver::start(){
+	if(sockfd < 0 && !bind()) return;
+	while(true){
+		int clientfd = ::accept(sockfd, NULL, NULL);
+		if(clientfd < 0){
+			std::cerr << "Warning: Receiver could not accept connection." << std::endl;
+			continue;
+		}
+		setNoSigPipe(clientfd);
+		std::thread(&LoopbackReceiver::handleConnection, this, clientfd).detach();
+	}
+}
+
+void LoopbackReceiver::record(size_t bytes){
+	if(!log.is_open()) return;
+	auto now = std::chrono::steady_clock::now();
+	std::lock_guard<std::mutex> guard(logMutex);
+	log << std::chrono::duration_cast<std::chrono::milliseconds>(now - started).count() << "," << bytes << std::endl;
+}
+
+void LoopbackReceiver::handleConnection(int clientfd){
+	std::string buf;
+	char chunk[64 * 1024];
+	while(true){
+		// Read until the end of the request headers.
+		std::string::size_type end;
+		while((end = buf.find("\r\n\r\n")) == std::string::npos){
+			ssize_t n = ::read(clientfd, chunk, sizeof(chunk));
+			if(n <= 0){
+				::close(clientfd);
+				return;
+			}
+			buf.append(chunk, n);
+		}
+		std::string head = buf.substr(0, end);
+		buf.erase(0, end + 4);
+
+		// Find the body length (header names are case-insensitive).
+		size_t length = 0;
+		std::string lower = head;
+		for(char& c : lower) c = std::tolower(c);
+		std::string::size_type at = lower.find("content-length:");
+		if(at != std::string::npos) length = strtoul(head.c_str() + at + 15, NULL, 10);
+
+		// Read the body.
+		while(buf.length() < length){
+			ssize_t n = ::read(clientfd, chunk, sizeof(chunk));
+			if(n <= 0){
+				::close(clientfd);
+				return;
+			}
+			buf.append(chunk, n);
+		}
+		buf.erase(0, length);
+
+		// Record photos and acknowledge every request.
+		int code = 200;
+		if(head.find("PUT /photo ") == 0U || head.find("POST /photo ") == 0U){
+			record(length);
+		} else if(head.find("GET /server-info ") != 0U){
+			code = 404;
+		}
+		std::string resp = (code == 200 ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 404 Not Found\r\n");
+		resp += "Content-Length: 0\r\n\r\n";
+		if(sendNoSignal(clientfd, resp.c_str(), resp.length()) < 0){
+			::close(clientfd);
+			return;
+		}
+	}
+}
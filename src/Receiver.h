@@ -0,0 +1,30 @@
+#ifndef RECEIVER_INC
+#define RECEIVER_INC
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+
+// Local stand-in for an Airplay receiver. Accepts PUT /photo over HTTP on the
+// loopback interface and logs when each frame arrived and how large it was (if
+// given a log path), so the game/render/send pipeline can run (and be measured)
+// without Apple hardware. Nothing is kept in memory per frame.
+class LoopbackReceiver {
+	private:
+		const int port;
+		int sockfd = -1;
+		std::mutex logMutex; // protects log
+		std::ofstream log; // optional CSV log of arrivals
+		const std::chrono::steady_clock::time_point started;
+
+		void handleConnection(int clientfd); // serve one (kept-alive) client connection
+		void record(size_t bytes);
+	public:
+		LoopbackReceiver(int port, std::string logPath = "");
+		~LoopbackReceiver(){ }
+
+		bool bind(); // bind and listen on 127.0.0.1:port
+		void start(); // accept loop (blocking), one thread per connection
+};
+
+#endif
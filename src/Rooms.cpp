@@ -0,0 +1,48 @@
+#include "Rooms.h"
+
+void Room::start(Scheduler& scheduler, unsigned int level, GameMode mode){
+	// Rooms live for the lifetime of the process, so the scheduler may keep pointers to their games.
+	game.schedule(scheduler, level, mode);
+}
+
+bool RoomRegistry::isValidId(const std::string& id){
+	if(id.empty() || id.length() > MAX_ROOM_ID_LENGTH) return false;
+	for(char c : id){
+		if(!std::isalnum(c) && c != '_' && c != '-') return false;
+	}
+	return true;
+}
+
+RoomRegistry::Shard& RoomRegistry::shardFor(const std::string& id){
+	return shards[std::hash<std::string>()(id) % ROOM_SHARDS];
+}
+
+Room* RoomRegistry::addRoom(const std::string& id, FrameSink* sink, SnapshotWriter* snapshots){
+	if(!isValidId(id)) return nullptr;
+	Shard& shard = shardFor(id);
+	std::lock_guard<std::mutex> guard(shard.shardMutex);
+	auto it = shard.rooms.find(id);
+	if(it != shard.rooms.end()) return it->second.get();
+	if(roomCount >= MAX_ROOMS) return nullptr;
+	Room* room = new Room(id, sink, assets);
+	room->getGame().setSnapshotWriter(snapshots);
+	room->getGame().setAllowAnyWord(allowAnyWord);
+	shard.rooms[id] = std::unique_ptr<Room>(room);
+	++roomCount;
+	room->start(scheduler, level, mode);
+	std::cerr << "Opened room '" << id << "' (" << roomCount << " room(s))." << std::endl;
+	return room;
+}
+
+Game* RoomRegistry::getGame(const std::string& id){
+	// Fast path: the room already exists.
+	{
+		if(!isValidId(id)) return nullptr;
+		Shard& shard = shardFor(id);
+		std::lock_guard<std::mutex> guard(shard.shardMutex);
+		auto it = shard.rooms.find(id);
+		if(it != shard.rooms.end()) return &it->second->getGame();
+	}
+	Room* room = addRoom(id, nullptr);
+	return (room ? &room->getGame() : nullptr);
+}
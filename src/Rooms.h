@@ -0,0 +1,54 @@
+#ifndef ROOMS_INC
+#define ROOMS_INC
+#include "Game.h"
+#include <map>
+#include <memory>
+#include <atomic>
+
+#define ROOM_SHARDS 64 // independent locks over the room table
+#define MAX_ROOMS 1000 // rooms are created on first use, up to this many
+#define MAX_ROOM_ID_LENGTH 32
+#define DEFAULT_ROOM "default" // room used by routes without a /room/<id> prefix
+
+// One hosted game; its rounds run on the registry's shared scheduler.
+class Room {
+	private:
+		const std::string id;
+		Game game;
+	public:
+		Room(std::string i, FrameSink* sink, std::shared_ptr<GameAssets> assets) : id(i), game(sink, assets){ }
+
+		void start(Scheduler& scheduler, unsigned int level, GameMode mode); // run the game on the scheduler
+		Game& getGame(){ return game; }
+		const std::string& getId(){ return id; }
+};
+
+// All rooms hosted by this process. Rooms are spread over shards by id, each with its own
+// lock, so looking up one room never waits on another; every room has its own game state
+// and gameMutex, and all of them share one set of GameAssets.
+class RoomRegistry {
+	private:
+		struct Shard {
+			std::mutex shardMutex;
+			std::map<std::string, std::unique_ptr<Room> > rooms;
+		};
+		Shard shards[ROOM_SHARDS];
+		std::atomic<unsigned int> roomCount{0};
+		std::shared_ptr<GameAssets> assets;
+		Scheduler& scheduler; // runs every room's game
+		const unsigned int level; // for new rooms
+		const GameMode mode; // for new rooms
+		const bool allowAnyWord; // for new rooms; set by the operator at startup, never by players
+
+		Shard& shardFor(const std::string& id);
+	public:
+		RoomRegistry(std::shared_ptr<GameAssets> a, Scheduler& s, unsigned int l, GameMode m, bool any = false) : assets(a), scheduler(s), level(l), mode(m), allowAnyWord(any){ }
+
+		static bool isValidId(const std::string& id); // [A-Za-z0-9_-], 1 to MAX_ROOM_ID_LENGTH characters
+		Room* addRoom(const std::string& id, FrameSink* sink, SnapshotWriter* snapshots = nullptr); // create and start a room showing on the given sink
+		Game* getGame(const std::string& id); // existing room, or a new web-only room; nullptr if invalid or full
+		unsigned int getRoomCount(){ return roomCount; }
+		GameAssets& getAssets(){ return *assets; } // shared by every room
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "Scheduler.h"
+
+Scheduler::Scheduler(unsigned int n) : epoch(std::chrono::steady_clock::now()){
+	if(n == 0) n = 1;
+	for(unsigned int i = 0; i < n; i++){
+		workers.push_back(std::thread(&Scheduler::runWorker, this));
+	}
+	ticker = std::thread(&Scheduler::runTicker, this);
+}
+
+Scheduler::~Scheduler(){
+	readyMutex.lock();
+	stopping = true;
+	readyMutex.unlock();
+	readyCond.notify_all();
+	wheelMutex.lock();
+	tickerStopping = true;
+	wheelMutex.unlock();
+	wheelCond.notify_all();
+	for(std::thread& t : workers) t.join();
+	ticker.join();
+}
+
+uint64_t Scheduler::tickAt(std::chrono::steady_clock::time_point t){
+	return (uint64_t)(std::chrono::duration_cast<std::chrono::microseconds>(t - epoch).count() / (SCHEDULER_TICK_MS * 1000));
+}
+
+void Scheduler::post(Continuation fn){
+	readyMutex.lock();
+	ready.push_back(std::move(fn));
+	readyMutex.unlock();
+	readyCond.notify_one();
+}
+
+void Scheduler::postAfter(unsigned int ms, Continuation fn){
+	// Round the deadline up to a whole tick so the timer never fires early.
+	auto now = std::chrono::steady_clock::now();
+	auto deadline = now + std::chrono::milliseconds(ms);
+	uint64_t due = (uint64_t)((std::chrono::duration_cast<std::chrono::microseconds>(deadline - epoch).count() + SCHEDULER_TICK_MS * 1000 - 1) / (SCHEDULER_TICK_MS * 1000));
+	std::lock_guard<std::mutex> lock(wheelMutex);
+	if(timerCount == 0 && currentTick < tickAt(now)) currentTick = tickAt(now); // the ticker idled; nothing to catch up on
+	if(due <= currentTick) due = currentTick + 1;
+	wheel[due % SCHEDULER_WHEEL_SLOTS].push_back(Timer{due, std::move(fn)});
+	if(timerCount++ == 0) wheelCond.notify_one();
+}
+
+void Scheduler::runWorker(){
+	std::unique_lock<std::mutex> lock(readyMutex);
+	while(true){
+		readyCond.wait(lock, [this]{ return stopping || !ready.empty(); });
+		if(stopping) return;
+		Continuation fn = std::move(ready.front());
+		ready.pop_front();
+		lock.unlock();
+		fn();
+		lock.lock();
+	}
+}
+
+void Scheduler::runTicker(){
+	std::vector<Continuation> fired;
+	std::unique_lock<std::mutex> lock(wheelMutex);
+	while(true){
+		// Sleep until there is something on the wheel, then catch up to the present.
+		wheelCond.wait(lock, [this]{ return tickerStopping || timerCount > 0; });
+		if(tickerStopping) return;
+
+		// Wake on absolute tick boundaries, so timing does not drift with processing time.
+		auto next = epoch + std::chrono::milliseconds((currentTick + 1) * SCHEDULER_TICK_MS);
+		lock.unlock();
+		std::this_thread::sleep_until(next);
+		lock.lock();
+		if(tickerStopping) return;
+
+		// Fire everything due in the slots we passed; timers for a later turn stay put.
+		const uint64_t now = tickAt(std::chrono::steady_clock::now());
+		while(currentTick < now && timerCount > 0){
+			++currentTick;
+			std::vector<Timer>& slot = wheel[currentTick % SCHEDULER_WHEEL_SLOTS];
+			for(size_t i = 0; i < slot.size(); ){
+				if(slot[i].due <= currentTick){
+					fired.push_back(std::move(slot[i].fn));
+					slot[i] = std::move(slot.back());
+					slot.pop_back();
+					--timerCount;
+				} else {
+					++i;
+				}
+			}
+		}
+		if(timerCount == 0 && currentTick < now) currentTick = now; // idle: skip ahead
+		lock.unlock();
+		for(Continuation& fn : fired) post(std::move(fn));
+		fired.clear();
+		lock.lock();
+	}
+}
@@ -0,0 +1,57 @@
+#ifndef SCHEDULER_INC
+#define SCHEDULER_INC
+#include <functional>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+
+#define SCHEDULER_WORKERS 4 // threads running continuations for every game in the process
+#define SCHEDULER_TICK_MS 5 // timer wheel resolution
+#define SCHEDULER_WHEEL_SLOTS 1024 // one turn of the wheel covers SLOTS * TICK_MS; longer timers wait extra turns
+
+// Runs many small continuations on a fixed pool of worker threads, with a hashed timer
+// wheel for delayed ones. A game hands the scheduler "the rest of its round" whenever it
+// would otherwise block, so thousands of games share a handful of threads.
+class Scheduler {
+	public:
+		typedef std::function<void()> Continuation;
+	private:
+		struct Timer {
+			uint64_t due; // tick at which the timer fires
+			Continuation fn;
+		};
+
+		std::mutex readyMutex; // protects ready and stopping
+		std::condition_variable readyCond;
+		std::deque<Continuation> ready; // continuations waiting for a worker
+		bool stopping = false;
+
+		std::mutex wheelMutex; // protects everything below
+		std::condition_variable wheelCond; // signalled when the wheel goes from empty to non-empty or on shutdown
+		std::vector<Timer> wheel[SCHEDULER_WHEEL_SLOTS];
+		uint64_t currentTick = 0; // last tick the wheel has processed
+		size_t timerCount = 0; // timers on the wheel
+		bool tickerStopping = false; // the ticker's own shutdown flag, so it never reads stopping
+		const std::chrono::steady_clock::time_point epoch; // time of tick 0
+
+		std::vector<std::thread> workers;
+		std::thread ticker;
+
+		// Helper methods.
+		void runWorker(); // worker thread body
+		void runTicker(); // timer thread body
+		uint64_t tickAt(std::chrono::steady_clock::time_point t); // ticks since epoch (rounded down)
+	public:
+		Scheduler(unsigned int workers = SCHEDULER_WORKERS);
+		~Scheduler();
+
+		void post(Continuation fn); // run as soon as a worker is free; never blocks
+		void postAfter(unsigned int ms, Continuation fn); // run after at least ms milliseconds; never blocks
+		unsigned int getWorkerCount(){ return (unsigned int)workers.size(); }
+};
+
+#endif
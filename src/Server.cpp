@@ -1,4 +1,5 @@
 #include "Server.h"
+#include "Startup.h"
 #include <errno.h>
 #include <netdb.h>
 #include <sys/socket.h>
@@ -7,8 +8,35 @@
 #include <sys/stat.h>
 
 #define MAX_BACKLOG 500
+#define SERVER_WORKERS 8 // threads accepting and handling requests
+
+// Routes that need a loaded Game; until it is ready they answer with a "warming up" state.
+static const char* GAME_ROUTES[] = {
+	"/getExtantLetters", "/guessLetter?", "/guessPercentage", "/getBlankedWord", "/getLatestAlert", "/getGameInfo",
+	"/chooseWord?", "/setWordLength?", "/setLetterInWord?", "/setWordLocations?", "/setActualWord?", "/getWordFillForm"
+};
+// Operator routes: they change the server for everyone (or turn off a room's checks), so they
+// only answer POST requests (links and prefetchers cannot trigger them) from this machine.
+static const char* OPERATOR_ROUTES[] = {
+	"/reloadWordlist", "/setAllowAnyWord?"
+};
+static const std::string WARMING_UP_JSON = "{\"warmingUp\": true, \"success\": false, \"error\": \"The game is still starting up.\", \"message\": \"The game is still starting up.\"}";
+
+static bool isGameRoute(const std::string& path){
+	for(const char* route : GAME_ROUTES){
+		if(path.find(route) == 0U) return true;
+	}
+	return false;
+}
+
+static bool isOperatorRoute(const std::string& path){
+	for(const char* route : OPERATOR_ROUTES){
+		if(path.find(route) == 0U) return true;
+	}
+	return false;
+}
 
-Server::Server(std::string h, int p, Game& g) : host(h), port(p), game(g) {
+Server::Server(std::string h, int p, RoomRegistry& r) : host(h), port(p), rooms(r) {
 	//
 }
 
@@ -42,158 +70,248 @@ std::string Server::getClientIP(int sock){
     return ret;
 }
 
+bool Server::isLocalClient(int sock){
+	struct sockaddr_in addr;
+	socklen_t addr_size = sizeof(struct sockaddr_in);
+	if(getpeername(sock, (struct sockaddr*)&addr, &addr_size) == -1 || addr.sin_family != AF_INET) return false;
+	return (ntohl(addr.sin_addr.s_addr) >> 24) == 127; // 127.0.0.0/8
+}
+
 void Server::setClientOfInterest(int sock){
-    clientOfInterest = getClientIP(sock);
+    std::string ip = getClientIP(sock);
+    std::lock_guard<std::mutex> guard(clientMutex);
+    clientOfInterest = ip;
+}
+
+void Server::handleGameRoute(Game& game, int sock, const std::string& path, int& code, std::string& ret, std::string& mime){
+	if(path == "/getExtantLetters"){
+		mime = "application/json";
+		const LetterMask guessed = game.getSnapshot()->guessed;
+		std::vector<char> extant = maskLetters(~guessed & LETTER_MASK_ALL);
+		ret = "{\"guessed\": " + std::to_string(guessed) + ", \"letters\": [";
+		for(auto it = extant.begin(); it != extant.end(); it++){
+			ret += "\"";
+			ret.push_back(*it);
+			ret += "\"";
+			if((it + 1) != extant.end()) ret += ",";
+		}
+		ret += "]}";
+	} else if(path.find("/guessLetter?letter=") == 0U){
+		mime = "application/json";
+		int letter_code = 0;
+		for(unsigned long int i = 20; i < path.length(); i++){
+			letter_code *= 10;
+			letter_code += path[i] - '0';
+		}
+		char letter = (char)letter_code;
+		GuessResult result = game.guessLetter(letter);
+		bool error = true; // error with input
+		bool success = false; // correctness of guess
+		std::stringstream msg;
+		switch(result.status){
+			case GUESS_NO_GUESSES_LEFT:
+				msg << "All " << GUESS_LIMIT << " guesses have been used.";
+				break;
+			case GUESS_INVALID_LETTER:
+				msg << "Invalid character '" << letter << "'- must be a lowercase letter.";
+				break;
+			case GUESS_ALREADY_GUESSED:
+				msg << "Someone already guessed that letter!";
+				break;
+			case GUESS_NOT_PLAYING:
+				msg << "No round is accepting guesses right now.";
+				break;
+			case GUESS_CORRECT:
+				error = false;
+				success = true;
+				msg << "Correct! There ";
+				if(result.instances == 1) msg << "was 1 instance";
+				else msg << "were " << result.instances << " instances";
+				msg << " of '" << letter << "' in the word.";
+				break;
+			case GUESS_INCORRECT:
+				error = false;
+				msg << "The letter '" << letter << "' was not in the word.";
+				break;
+		}
+		ret = "{\"error\": " + std::string(error ? "true" : "false");
+		ret += ", \"message\": \"" + msg.str() + "\", \"success\": ";
+		ret += std::string(success ? "true" : "false") + "}";
+	} else if(path == "/guessPercentage"){
+		mime = "application/json";
+		double percent = double(countLetters(game.getSnapshot()->incorrect)) / GUESS_LIMIT * 100.0f;
+		char buf[20];
+		sprintf(buf, "%.2f", percent);
+		ret = "{\"percentage\": \"" + std::string(buf) + "\"}";
+	} else if(path == "/getBlankedWord"){
+		mime = "application/json";
+		std::shared_ptr<const GameSnapshot> state = game.getSnapshot();
+		std::stringstream fmt;
+		fmt << "{\"blanked\": \"" << state->blankedWord << "\", \"length\": " << state->word.length() << "}";
+		ret = fmt.str();
+	} else if(path == "/getLatestAlert"){
+		mime = "application/json";
+		std::string alert = game.getLatestAlert();
+		ret = "{\"alert\": \"" + alert + "\"}";
+	} else if(path == "/getGameInfo"){
+		mime = "application/json";
+		std::shared_ptr<const GameSnapshot> state = game.getSnapshot(); // one consistent view for every field
+		std::stringstream fmt;
+		fmt << "{\"level\":" << state->level;
+		fmt << ", \"index\": " << state->gameInd;
+		fmt << ", \"result\": " << state->lastGameResult;
+		fmt << ", \"word\": \"" << (state->flashDelay ? state->word : "") << "\"";
+		fmt << ", \"ip_addr\": \"" << getClientIP(sock) << "\"";
+		fmt << ", \"waitingForWord\": " << (state->waitingForWord ? "true" : "false");
+		fmt << ", \"allowAnyWord\": " << (state->allowAnyWord ? "true" : "false");
+		fmt << ", \"score\": " << state->score << "}";
+		ret = fmt.str();
+	} else if(path.find("/chooseWord?word=") == 0U){
+		mime = "application/json";
+		std::stringstream fmt;
+		std::string err = game.chooseWord(path.substr(17U));
+		bool suc = (err.length() == 0UL);
+		if(suc){
+			setClientOfInterest(sock);
+		}
+		fmt << "{\"success\": " << (suc ? "true" : "false");
+		fmt << ", \"error\": \"" << err << "\"";
+		fmt << "}";
+		ret = fmt.str();
+	} else if(path.find("/setWordLength?length=") == 0U){
+		mime = "application/json";
+		std::stringstream fmt;
+		std::string err = game.chooseLength(atoi(path.substr(22U).c_str()));
+		bool suc = (err.length() == 0UL);
+		if(suc){
+			setClientOfInterest(sock);
+		}
+		fmt << "{\"success\": " << (suc ? "true" : "false");
+		fmt << ", \"error\": \"" << err << "\"";
+		fmt << "}";
+		ret = fmt.str();
+	} else if(path.find("/setLetterInWord?in_word=") == 0U){
+		mime = "application/json";
+		std::stringstream fmt;
+		std::string err = game.saveGuessResult(path.substr(25U));
+		bool suc = (err.length() == 0UL);
+		if(suc){
+			setClientOfInterest(sock);
+		}
+		fmt << "{\"success\": " << (suc ? "true" : "false");
+		fmt << ", \"error\": \"" << err << "\"";
+		fmt << "}";
+		ret = fmt.str();
+	} else if(path.find("/setWordLocations?word=") == 0U){
+		mime = "application/json";
+		std::stringstream fmt;
+		std::string err = game.saveWordLocations(path.substr(23U));
+		bool suc = (err.length() == 0UL);
+		if(suc){
+			setClientOfInterest(sock);
+		}
+		fmt << "{\"success\": " << (suc ? "true" : "false");
+		fmt << ", \"error\": \"" << err << "\"";
+		fmt << "}";
+		ret = fmt.str();
+	} else if(path.find("/setActualWord?word=") == 0U){
+		mime = "application/json";
+		std::stringstream fmt;
+		std::string err = game.saveActualWord(path.substr(20U));
+		bool suc = (err.length() == 0UL);
+		if(suc){
+			setClientOfInterest(sock);
+		}
+		fmt << "{\"success\": " << (suc ? "true" : "false");
+		fmt << ", \"error\": \"" << err << "\"";
+		fmt << "}";
+		ret = fmt.str();
+	} else if(path == "/getWordFillForm"){
+		ret = game.getWordHTMLForm();
+	} else {
+		code = 404;
+	}
+}
+
+void Server::handleOperatorRoute(const std::string& roomId, const std::string& path, int& code, std::string& ret, std::string& mime){
+	mime = "application/json";
+	if(path == "/reloadWordlist"){
+		// Rebuild the wordlist for every room; rounds in progress finish with the old one.
+		// A request while a reload is running is refused, not queued.
+		bool suc = rooms.getAssets().reloadWordlist();
+		std::string err = (suc ? "" : (rooms.getAssets().isReady() ? "A reload is already running." : "The game is still starting up."));
+		ret = "{\"success\": " + std::string(suc ? "true" : "false") + ", \"error\": \"" + err + "\"}";
+	} else if(path.find("/setAllowAnyWord?allow=") == 0U){
+		// Per room: whether players may choose words that are not in the wordlist
+		// (new rooms start with --allow-any-word).
+		Game* room = rooms.getGame(roomId);
+		if(!room){
+			code = 404;
+			return;
+		}
+		bool allow = (path.substr(23U) == "1" || path.substr(23U) == "true");
+		room->setAllowAnyWord(allow);
+		ret = "{\"success\": true, \"allowAnyWord\": " + std::string(allow ? "true" : "false") + "}";
+	} else {
+		code = 404;
+	}
 }
 
 void Server::handleRequest(int sock, std::string&& req){
-	// Parse request, only handling HTTP GET requests. //
-	if(req.find("GET ") == 0U && req.find(" HTTP/1.1") != std::string::npos){
-		// Extract requested path from GET request. //
-		std::string path = req.substr(4, req.find(" HTTP/1.1") - 4);
+	// Parse request, handling HTTP GET requests (and POST for operator routes). //
+	std::string method = (req.find("GET ") == 0U ? "GET" : (req.find("POST ") == 0U ? "POST" : ""));
+	if(method.length() && req.find(" HTTP/1.1") != std::string::npos){
+		// Extract requested path from the request line. //
+		std::string path = req.substr(method.length() + 1, req.find(" HTTP/1.1") - method.length() - 1);
 		//printf("Requested path: |%s|.\n", path.c_str());
 
+		// Strip the room prefix (/room/<id>/...), if any.
+		std::string roomId = DEFAULT_ROOM;
+		std::string location; // redirect target
+		if(path.find("/room/") == 0U){
+			std::string::size_type slash = path.find('/', 6);
+			roomId = path.substr(6, slash == std::string::npos ? std::string::npos : slash - 6);
+			if(slash == std::string::npos){
+				location = path + "/"; // so relative URLs in the page resolve inside the room
+				path = "";
+			} else {
+				path = path.substr(slash);
+			}
+		}
+
 		// Decide what to send back based on requested path.
 		int code = 200; // return code
 		std::string ret; // return body
 		std::string mime = "text/html"; // MIME-type
 		if(path.find("../") != std::string::npos || path.find("/..") != std::string::npos){
 			code = 403;
+		} else if(!RoomRegistry::isValidId(roomId)){
+			code = 404;
+		} else if(location.length()){
+			code = 301;
+		} else if(isOperatorRoute(path)){
+			if(method != "POST"){
+				code = 405;
+			} else if(!isLocalClient(sock)){
+				code = 403;
+			} else {
+				handleOperatorRoute(roomId, path, code, ret, mime);
+			}
+		} else if(method != "GET"){
+			code = 405;
 		} else if(path == "/" || path == "/index.html"){
 			ret = readFile("data/index.html");
-		} else if(path == "/getExtantLetters"){
-			mime = "application/json";
-			auto guessed = game.getGuessedLetters();
-			std::vector<char> extant;
-			for(char c = 'a'; c <= 'z'; c++){
-				if(std::find(guessed.begin(), guessed.end(), c) == guessed.end()){
-					extant.push_back(c);
-				}
-			}
-			ret = "{\"letters\": [";
-			for(auto it = extant.begin(); it != extant.end(); it++){
-				ret += "\"";
-				ret.push_back(*it);
-				ret += "\"";
-				if((it + 1) != extant.end()) ret += ",";
-			}
-			ret += "]}";
-		} else if(path.find("/guessLetter?letter=") == 0U){
-			mime = "application/json";
-			int letter_code = 0;
-			for(unsigned long int i = 20; i < path.length(); i++){
-				letter_code *= 10;
-				letter_code += path[i] - '0';
-			}
-			char letter = (char)letter_code;
-			auto guessed = game.getGuessedLetters();
-			bool error = false; // error with input
-			bool success = false; // correctness of guess
-			std::stringstream msg;
-			if(game.getIncorrectGuessesNum() >= GUESS_LIMIT){
-				error = true;
-				msg << "All " << GUESS_LIMIT << " guesses have been used.";
-			} else if(!std::isalpha(letter) || !std::islower(letter)){
-				error = true;
-				msg << "Invalid character '" << letter << "'- must be a lowercase letter.";
-			} else if(std::find(guessed.begin(), guessed.end(), letter) != guessed.end()){
-				error = true;
-				msg << "Someone already guessed that letter!";
+		} else if(isGameRoute(path)){
+			// Resolve the room, creating it on first use.
+			Game* room = rooms.getGame(roomId);
+			if(!room){
+				code = 404;
+			} else if(!room->isReady()){
+				mime = "application/json";
+				ret = WARMING_UP_JSON;
 			} else {
-				int instances = game.guessLetter(letter);
-				error = false;
-				if(instances > 0){
-					success = true;
-					msg << "Correct! There ";
-					if(instances == 1) msg << "was 1 instance";
-					else msg << "were " << instances << " instances";
-					msg << " of '" << letter << "' in the word.";
-				} else {
-					msg << "The letter '" << letter << "' was not in the word.";
-				}
-			}
-			ret = "{\"error\": " + std::string(error ? "true" : "false");
-			ret += ", \"message\": \"" + msg.str() + "\", \"success\": ";
-			ret += std::string(success ? "true" : "false") + "}";
-		} else if(path == "/guessPercentage"){
-			mime = "application/json";
-			double percent = double(game.getIncorrectGuessesNum()) / GUESS_LIMIT * 100.0f;
-			char buf[20];
-			sprintf(buf, "%.2f", percent);
-			ret = "{\"percentage\": \"" + std::string(buf) + "\"}";
-		} else if(path == "/getBlankedWord"){
-			mime = "application/json";
-			std::string blanked = game.getBlankedWord();
-			std::stringstream fmt;
-			fmt << "{\"blanked\": \"" << blanked << "\", \"length\": " << game.getWordLength() << "}";
-			ret = fmt.str();
-		} else if(path == "/getLatestAlert"){
-			mime = "application/json";
-			std::string alert = game.getLatestAlert();
-			ret = "{\"alert\": \"" + alert + "\"}";
-		} else if(path == "/getGameInfo"){
-			mime = "application/json";
-			std::stringstream fmt;
-			std::string word = (game.inFlashDelay() ? game.getWord() : "");
-			unsigned int level = game.getLevel();
-			fmt << "{\"level\":" << level;
-			fmt << ", \"index\": " << game.getGameIndex();
-			fmt << ", \"result\": " << game.getLastGameResult();
-			fmt << ", \"word\": \"" << word << "\"";
-			fmt << ", \"ip_addr\": \"" << getClientIP(sock) << "\"";
-			fmt << ", \"waitingForWord\": " << (game.isWaitingForWord() ? "true" : "false");
-			fmt << ", \"score\": " << game.getScore() << "}";
-			ret = fmt.str();
-		} else if(path.find("/chooseWord?word=") == 0U){
-			mime = "application/json";
-			std::stringstream fmt;
-			std::string err = game.chooseWord(path.substr(17U));
-			bool suc = (err.length() == 0UL);
-			if(suc){
-				setClientOfInterest(sock);
+				handleGameRoute(*room, sock, path, code, ret, mime);
 			}
-			fmt << "{\"success\": " << (suc ? "true" : "false");
-			fmt << ", \"error\": \"" << err << "\"";
-			fmt << "}";
-			ret = fmt.str();
-		} else if(path.find("/setWordLength?length=") == 0U){
-			mime = "application/json";
-			std::stringstream fmt;
-			std::string err = game.chooseLength(atoi(path.substr(22U).c_str()));
-			bool suc = (err.length() == 0UL);
-			if(suc){
-				setClientOfInterest(sock);
-			}
-			fmt << "{\"success\": " << (suc ? "true" : "false");
-			fmt << ", \"error\": \"" << err << "\"";
-			fmt << "}";
-			ret = fmt.str();
-		} else if(path.find("/setLetterInWord?in_word=") == 0U){
-			mime = "application/json";
-			std::stringstream fmt;
-			std::string err = game.saveGuessResult(path.substr(25U));
-			bool suc = (err.length() == 0UL);
-			if(suc){
-				setClientOfInterest(sock);
-			}
-			fmt << "{\"success\": " << (suc ? "true" : "false");
-			fmt << ", \"error\": \"" << err << "\"";
-			fmt << "}";
-			ret = fmt.str();
-		} else if(path.find("/setWordLocations?word=") == 0U){
-			mime = "application/json";
-			std::stringstream fmt;
-			std::string err = game.saveWordLocations(path.substr(23U));
-			bool suc = (err.length() == 0UL);
-			if(suc){
-				setClientOfInterest(sock);
-			}
-			fmt << "{\"success\": " << (suc ? "true" : "false");
-			fmt << ", \"error\": \"" << err << "\"";
-			fmt << "}";
-			ret = fmt.str();
-		} else if(path == "/getWordFillForm"){
-			ret = game.getWordHTMLForm();
 		} else {
 			path = "data/" + path; // must be in the data directory
 			if(access(path.c_str(), F_OK ) != -1){
@@ -207,15 +325,23 @@ void Server::handleRequest(int sock, std::string&& req){
 		// Generate response based on code.
 		std::stringstream response;
 		std::string blurb = "OK"; // e.g. 200 OK
-		if(code == 403){
+		if(code == 301){
+			blurb = "Moved Permanently";
+		} else if(code == 403){
 			blurb = "Forbidden";
 		} else if(code == 404){
 			blurb = "Not Found";
+		} else if(code == 405){
+			blurb = "Method Not Allowed";
 		}
 		if(code != 200){
 			ret = "<html><head><title>" + blurb + "</title></head><body><h1>" + blurb + "</h1></body></html>";
+			mime = "text/html";
 		}
-		response << "HTTP/1.1 " << code << " " << blurb << "\r\nContent-Type: " << mime << "\r\nContent-Length: " << (ret.length() + 4) << "\r\nCache-Control: no-cache\r\n\r\n" << ret << "\r\n\r\n";
+		response << "HTTP/1.1 " << code << " " << blurb << "\r\nContent-Type: " << mime << "\r\nContent-Length: " << (ret.length() + 4) << "\r\nCache-Control: no-cache\r\n";
+		if(location.length()) response << "Location: " << location << "\r\n";
+		if(code == 405) response << "Allow: " << (isOperatorRoute(path) ? "POST" : "GET") << "\r\n";
+		response << "\r\n" << ret << "\r\n\r\n";
 
 		// Send response.
 		int at = 0;
@@ -229,10 +355,12 @@ void Server::handleRequest(int sock, std::string&& req){
 			}
 			at += n;
 		}
+		static std::atomic<bool> firstResponse(false);
+		startupMilestoneOnce(firstResponse, "first response");
 	}
 
 	// Close the socket. //
-	::close(clientfd);
+	::close(sock);
 }
 
 bool setTimeout(int sockfd, int timeout_secs){
@@ -248,7 +376,7 @@ bool setTimeout(int sockfd, int timeout_secs){
 
 void Server::start(void){
 	// Initialize variables.
-	struct sockaddr_in serv_addr, cli_addr;
+	struct sockaddr_in serv_addr;
 
 	// Create the socket.
 	sockfd = socket(AF_INET, SOCK_STREAM, 0);
@@ -274,13 +402,27 @@ void Server::start(void){
 		sleep(5);
 	}
 
-	// Start listening and loop, accepting new connections.
+	// Start listening, and accept new connections on several workers so that a slow
+	// client or a busy room does not hold up requests for other rooms.
 	::listen(sockfd, MAX_BACKLOG);
 	std::cerr << "Listening on port " << port << "..." << std::endl;
-	unsigned int cli_len = sizeof(cli_addr);
+	startupMilestone("socket bound");
+	std::vector<std::thread> workers;
+	for(unsigned int i = 1; i < SERVER_WORKERS; i++){
+		workers.push_back(std::thread(&Server::serve, this));
+	}
+	serve();
+	for(std::thread& t : workers){
+		t.join();
+	}
+}
+
+void Server::serve(void){
+	struct sockaddr_in cli_addr;
 	while(true){
 		// Accept a connection (blocking).
-		clientfd = ::accept(sockfd, (struct sockaddr*)&cli_addr, &cli_len);
+		socklen_t cli_len = sizeof(cli_addr);
+		int clientfd = ::accept(sockfd, (struct sockaddr*)&cli_addr, &cli_len);
 		if(clientfd < 0){
 			std::cerr << "Warning: Could not accept connection." << std::endl;
 			continue;
@@ -289,6 +431,7 @@ void Server::start(void){
 		// Set a timeout on the socket.
 		if(!setTimeout(clientfd, 3)){
 			std::cerr << "Warning: Could not set timeout on client socket." << std::endl;
+			::close(clientfd);
 			continue;
 		}
 
@@ -298,6 +441,7 @@ void Server::start(void){
 		bzero(buf, MESSAGE_SIZE);
 		if(::read(clientfd, buf, MESSAGE_SIZE - 1) < 0){
 			std::cerr << "Warning: Could not read from client socket." << std::endl;
+			::close(clientfd);
 			continue;
 		}
 
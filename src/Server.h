@@ -1,4 +1,5 @@
-#include "Game.h"
+#include "Rooms.h"
+#include <mutex>
 
 class Server {
 	private:
@@ -8,17 +9,21 @@ class Server {
 		
 		// Instance variables.
 		int sockfd;
-		int clientfd;
-		Game& game;
+		RoomRegistry& rooms;
+		std::mutex clientMutex; // protects clientOfInterest
 		std::string clientOfInterest; // this is set to the IP of the last client that chose a word for the computer/other users to guess
 		
 		// Helper methods.
 		std::string readFile(std::string fname);
 		void handleRequest(int clientfd, std::string&& req);
+		void handleGameRoute(Game& game, int clientfd, const std::string& path, int& code, std::string& ret, std::string& mime); // route that acts on one room's game
+		void handleOperatorRoute(const std::string& roomId, const std::string& path, int& code, std::string& ret, std::string& mime); // POST from this machine only
+		void serve(); // accept and handle connections (one worker)
 		std::string getClientIP(int clientfd);
+		bool isLocalClient(int clientfd); // peer is on this machine (loopback), for operator-only routes
 		void setClientOfInterest(int clientfd);
 	public:
-		Server(std::string host, int port, Game& game);
+		Server(std::string host, int port, RoomRegistry& rooms);
 		~Server(){ }
 		
 		void start();
@@ -0,0 +1,104 @@
+#include "Sink.h"
+#include <unistd.h>
+#include <cstring>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+void setNoSigPipe(int fd){
+#ifdef SO_NOSIGPIPE
+	int flagVal = 1;
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &flagVal, sizeof(flagVal));
+#else
+	(void)fd;
+#endif
+}
+
+ssize_t sendNoSignal(int fd, const char* data, size_t length){
+#ifdef MSG_NOSIGNAL
+	return ::send(fd, data, length, MSG_NOSIGNAL);
+#else
+	return ::send(fd, data, length, 0);
+#endif
+}
+
+bool AirplaySink::send(const std::string& frame){
+	try {
+		conn->send_message(MessageType::ShowPicture, frame);
+	} catch(...){
+		return false;
+	}
+	return true;
+}
+
+bool HttpPhotoSink::connectSocket(){
+	closeSocket();
+	sockfd = socket(AF_INET, SOCK_STREAM, 0);
+	if(sockfd < 0){
+		std::cerr << "Warning: Could not create socket for photo sink." << std::endl;
+		return false;
+	}
+	int flagVal = 1;
+	setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &flagVal, sizeof(flagVal));
+	setNoSigPipe(sockfd);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	if(inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1){
+		std::cerr << "Warning: Invalid photo sink address '" << host << "'." << std::endl;
+		closeSocket();
+		return false;
+	}
+	if(::connect(sockfd, (struct sockaddr*)&addr, sizeof(addr)) < 0){
+		closeSocket();
+		return false;
+	}
+	return true;
+}
+
+void HttpPhotoSink::closeSocket(){
+	if(sockfd >= 0) ::close(sockfd);
+	sockfd = -1;
+}
+
+bool HttpPhotoSink::sendOnce(const std::string& frame){
+	// Send the request headers and the JPEG body.
+	std::stringstream header;
+	header << "PUT /photo HTTP/1.1\r\n";
+	header << "Host: " << host << ":" << port << "\r\n";
+	header << "User-Agent: MediaControl/1.0\r\n";
+	header << "Content-Type: image/jpeg\r\n";
+	header << "Content-Length: " << frame.length() << "\r\n\r\n";
+	const std::string head = header.str();
+	const std::string* parts[2] = {&head, &frame};
+	for(const std::string* part : parts){
+		size_t at = 0;
+		while(at < part->length()){
+			ssize_t n = sendNoSignal(sockfd, part->data() + at, part->length() - at);
+			if(n <= 0) return false; // e.g. EPIPE: the receiver closed the connection
+			at += n;
+		}
+	}
+
+	// Read the response headers and check the status code.
+	std::string resp;
+	char buf[512];
+	while(resp.find("\r\n\r\n") == std::string::npos){
+		ssize_t n = ::read(sockfd, buf, sizeof(buf));
+		if(n <= 0) return false;
+		resp.append(buf, n);
+	}
+	return resp.find("HTTP/1.1 200") == 0U;
+}
+
+bool HttpPhotoSink::send(const std::string& frame){
+	// Reuse the kept-alive connection, reconnecting once if it went away.
+	if(sockfd >= 0 && sendOnce(frame)) return true;
+	if(!connectSocket()) return false;
+	if(sendOnce(frame)) return true;
+	closeSocket();
+	return false;
+}
@@ -0,0 +1,49 @@
+#ifndef SINK_INC
+#define SINK_INC
+#include <string>
+#include <memory>
+#include <sys/types.h>
+#include "Words.h"
+
+// Writes to kept-alive sockets whose peer may have gone away: they fail with EPIPE instead of
+// raising SIGPIPE, which would kill the process (MSG_NOSIGNAL on Linux, SO_NOSIGPIPE on macOS).
+void setNoSigPipe(int fd); // call once on each new socket
+ssize_t sendNoSignal(int fd, const char* data, size_t length);
+
+// Destination for encoded game frames (JPEG data).
+class FrameSink {
+	public:
+		virtual ~FrameSink(){ }
+		virtual bool send(const std::string& frame) = 0; // returns false if the frame could not be delivered
+		virtual bool sendShared(std::shared_ptr<const std::string> frame){ return send(*frame); } // for sinks that keep the frame
+};
+
+// Sends frames to an Airplay device through libairplay. send_message reports no result,
+// so a frame counts as delivered unless it throws (e.g. the connection dropped); a device
+// that hangs instead is caught by BroadcastSink's stall detection.
+class AirplaySink : public FrameSink {
+	private:
+		std::unique_ptr<airplay_device> conn;
+	public:
+		AirplaySink(std::unique_ptr<airplay_device> c) : conn(std::move(c)){ }
+		bool send(const std::string& frame);
+};
+
+// Speaks the Airplay photo endpoint (PUT /photo) directly over HTTP, e.g. to a
+// LoopbackReceiver. The connection is kept alive between frames.
+class HttpPhotoSink : public FrameSink {
+	private:
+		const std::string host;
+		const int port;
+		int sockfd = -1;
+
+		bool connectSocket(); // (re)connect to the receiver
+		void closeSocket();
+		bool sendOnce(const std::string& frame); // one attempt on the current connection
+	public:
+		HttpPhotoSink(std::string h, int p) : host(h), port(p){ }
+		~HttpPhotoSink(){ closeSocket(); }
+		bool send(const std::string& frame);
+};
+
+#endif
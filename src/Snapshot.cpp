@@ -0,0 +1,90 @@
+#include "Snapshot.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+SnapshotWriter::SnapshotWriter(std::string p, unsigned int minIntervalMs, unsigned int h) : path(p), minInterval(minIntervalMs), historySize(h) {
+	lastWrite = std::chrono::steady_clock::now() - minInterval;
+	worker = std::thread(&SnapshotWriter::run, this);
+}
+
+SnapshotWriter::~SnapshotWriter(){
+	{
+		std::lock_guard<std::mutex> guard(writerMutex);
+		stopping = true;
+	}
+	wakeup.notify_all();
+	worker.join();
+}
+
+void SnapshotWriter::submit(std::shared_ptr<const std::string> frame){
+	{
+		std::lock_guard<std::mutex> guard(writerMutex);
+		pending = std::move(frame); // only the newest frame matters
+	}
+	wakeup.notify_one();
+}
+
+std::string SnapshotWriter::historyPath(unsigned int ind){
+	// Insert the index before the extension, if any.
+	std::stringstream fmt;
+	std::string::size_type dot = path.rfind('.');
+	std::string::size_type slash = path.rfind('/');
+	if(dot == std::string::npos || (slash != std::string::npos && dot < slash)){
+		fmt << path << "." << ind;
+	} else {
+		fmt << path.substr(0, dot) << "." << ind << path.substr(dot);
+	}
+	return fmt.str();
+}
+
+bool SnapshotWriter::writeAtomically(const std::string& dest, const std::string& data){
+	const std::string tmp = dest + ".tmp";
+	{
+		std::ofstream ofp(tmp.c_str(), std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+		if(!ofp.is_open()){
+			std::cerr << "Warning: Could not open '" << tmp << "' for writing snapshot." << std::endl;
+			return false;
+		}
+		ofp.write(data.c_str(), data.length());
+		if(!ofp.good()){
+			std::cerr << "Warning: Could not write snapshot to '" << tmp << "'." << std::endl;
+			return false;
+		}
+	}
+	if(std::rename(tmp.c_str(), dest.c_str()) != 0){
+		perror("rename()");
+		std::remove(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+void SnapshotWriter::run(){
+	std::unique_lock<std::mutex> lock(writerMutex);
+	while(true){
+		// Wait for a frame (or shutdown).
+		wakeup.wait(lock, [this]{ return pending || stopping; });
+		if(stopping) break;
+
+		// Respect the write rate limit; newer frames submitted meanwhile replace the pending one.
+		auto due = lastWrite + minInterval;
+		if(std::chrono::steady_clock::now() < due){
+			wakeup.wait_until(lock, due, [this]{ return stopping; });
+			if(stopping) break;
+		}
+
+		// Take the frame and write it without holding the lock.
+		std::shared_ptr<const std::string> frame = std::move(pending);
+		pending.reset();
+		unsigned int slot = historyInd;
+		if(historySize > 0) historyInd = (historyInd + 1) % historySize;
+		lastWrite = std::chrono::steady_clock::now();
+		lock.unlock();
+		writeAtomically(path, *frame);
+		if(historySize > 0) writeAtomically(historyPath(slot), *frame);
+		frame.reset(); // drop the reference outside the lock
+		lock.lock();
+	}
+}
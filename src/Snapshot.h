@@ -0,0 +1,38 @@
+#ifndef SNAPSHOT_INC
+#define SNAPSHOT_INC
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+// Debug sink that mirrors rendered frames to disk from a background thread.
+// Frames are written atomically (temporary file + rename), rate-limited, and
+// optionally kept as a rotating history of the last N frames.
+class SnapshotWriter {
+	private:
+		const std::string path; // destination of the latest frame (e.g. "out.jpeg")
+		const std::chrono::milliseconds minInterval; // minimum time between two writes
+		const unsigned int historySize; // number of past frames to keep (0 = none)
+
+		std::mutex writerMutex; // protects everything below
+		std::condition_variable wakeup; // signalled when a frame is pending or on shutdown
+		std::shared_ptr<const std::string> pending; // latest frame not yet written (newer frames replace it)
+		bool stopping = false;
+		unsigned int historyInd = 0; // next slot in the rotating history
+		std::chrono::steady_clock::time_point lastWrite; // time of the last write
+		std::thread worker; // background writer thread
+
+		// Helper methods.
+		void run(); // writer thread body
+		bool writeAtomically(const std::string& dest, const std::string& data); // write to a temporary file and rename over dest
+		std::string historyPath(unsigned int ind); // e.g. "out.3.jpeg"
+	public:
+		SnapshotWriter(std::string path = "out.jpeg", unsigned int minIntervalMs = 1000, unsigned int historySize = 0);
+		~SnapshotWriter();
+
+		void submit(std::shared_ptr<const std::string> frame); // queue a frame (kept by reference, so it must not change); never blocks on disk I/O
+};
+
+#endif
@@ -0,0 +1,23 @@
+#include "Startup.h"
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <iostream>
+
+static std::mutex startupMutex;
+static std::chrono::steady_clock::time_point startupTime = std::chrono::steady_clock::now();
+static std::set<std::string> reached; // milestones already logged
+
+void startupBegin(){
+	std::lock_guard<std::mutex> guard(startupMutex);
+	startupTime = std::chrono::steady_clock::now();
+	reached.clear();
+}
+
+void startupMilestone(const char* name){
+	std::lock_guard<std::mutex> guard(startupMutex);
+	if(!reached.insert(name).second) return;
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupTime).count();
+	std::cerr << "Startup: " << name << " after " << (long)ms << " ms." << std::endl;
+}
@@ -0,0 +1,17 @@
+#ifndef STARTUP_INC
+#define STARTUP_INC
+#include <atomic>
+
+// Startup timeline: records how long after startupBegin() each milestone (e.g. "first
+// response", "first frame") was first reached, and logs it once.
+void startupBegin(); // call as early as possible in main
+void startupMilestone(const char* name); // log the first occurrence of a milestone
+
+// For milestones on hot paths (every frame, every request): after the first call this is
+// one relaxed load of the call site's flag, so the lock in startupMilestone stays off them.
+inline void startupMilestoneOnce(std::atomic<bool>& reachedHere, const char* name){
+	if(reachedHere.load(std::memory_order_relaxed) || reachedHere.exchange(true)) return;
+	startupMilestone(name);
+}
+
+#endif
@@ -0,0 +1,158 @@
+#include "WordIndex.h"
+#include "Words.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+
+static inline size_t align8(size_t n){
+	return (n + 7) & ~(size_t)7;
+}
+
+// Section sizes for an index with the given counts; returns the total file size.
+static size_t layoutIndex(uint32_t wordCount, uint32_t numLevels, uint32_t maxLength, uint32_t rankSlotCount, uint32_t postingCount,
+	uint64_t bitsetWordCount, uint64_t textSize, size_t sections[11]){
+	sections[0] = align8(sizeof(WordIndexHeader));
+	sections[1] = sections[0] + align8(sizeof(double) * wordCount);
+	sections[2] = sections[1] + align8(sizeof(uint32_t) * (numLevels + 1));
+	sections[3] = sections[2] + align8(sizeof(uint32_t) * ((size_t)wordCount + 1));
+	sections[4] = sections[3] + align8(sizeof(uint32_t) * ((size_t)maxLength + 2));
+	sections[5] = sections[4] + align8(sizeof(uint32_t) * wordCount);
+	sections[6] = sections[5] + align8(sizeof(uint32_t) * (size_t)rankSlotCount);
+	sections[7] = sections[6] + align8(sizeof(uint32_t) * (postingSlotCount(maxLength) + 1));
+	sections[8] = sections[7] + align8(sizeof(uint32_t) * (size_t)postingCount);
+	sections[9] = sections[8] + sizeof(uint64_t) * ((size_t)maxLength + 2);
+	sections[10] = sections[9] + sizeof(uint64_t) * (size_t)bitsetWordCount;
+	return sections[10] + align8(textSize);
+}
+
+static bool statSource(const std::string& path, uint64_t& size, int64_t& mtime){
+	struct stat st;
+	if(stat(path.c_str(), &st) != 0) return false;
+	size = (uint64_t)st.st_size;
+	mtime = (int64_t)st.st_mtime;
+	return true;
+}
+
+void WordIndex::close(){
+	if(base) munmap(base, size);
+	base = nullptr;
+	header = nullptr;
+}
+
+bool WordIndex::open(const std::string& path){
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if(fd < 0) return false;
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(WordIndexHeader)){
+		::close(fd);
+		return false;
+	}
+	size = (size_t)st.st_size;
+	base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(base == MAP_FAILED){
+		base = nullptr;
+		return false;
+	}
+
+	// Check the header and that every section fits before trusting any pointer.
+	header = (const WordIndexHeader*)base;
+	size_t sections[11];
+	if(header->magic != WORD_INDEX_MAGIC || header->version != WORD_INDEX_VERSION || header->numLevels != NUM_LEVELS ||
+	   layoutIndex(header->wordCount, header->numLevels, header->maxLength, header->rankSlotCount, header->postingCount,
+	   header->bitsetWordCount, header->textSize, sections) != size){
+		std::cerr << "Warning: '" << path << "' is not a valid wordlist index for this build." << std::endl;
+		close();
+		return false;
+	}
+	const char* bytes = (const char*)base;
+	scores = (const double*)(bytes + sections[0]);
+	levels = (const uint32_t*)(bytes + sections[1]);
+	offsets = (const uint32_t*)(bytes + sections[2]);
+	lengthStarts = (const uint32_t*)(bytes + sections[3]);
+	lengthRanks = (const uint32_t*)(bytes + sections[4]);
+	rankSlots = (const uint32_t*)(bytes + sections[5]);
+	postingStarts = (const uint32_t*)(bytes + sections[6]);
+	postingRanks = (const uint32_t*)(bytes + sections[7]);
+	bitsetStarts = (const uint64_t*)(bytes + sections[8]);
+	bitsets = (const uint64_t*)(bytes + sections[9]);
+	text = bytes + sections[10];
+	if(offsets[header->wordCount] != header->textSize || lengthStarts[header->maxLength + 1] != header->wordCount ||
+	   header->rankSlotCount <= header->wordCount || (header->rankSlotCount & (header->rankSlotCount - 1)) != 0 ||
+	   postingStarts[postingSlotCount(header->maxLength)] != header->postingCount ||
+	   bitsetStarts[header->maxLength + 1] != header->bitsetWordCount){
+		std::cerr << "Warning: '" << path << "' is corrupt." << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool WordIndex::matchesSource(const std::string& sourcePath){
+	if(header->minLetters != MIN_LETTERS) return false;
+	uint64_t sourceSize;
+	int64_t sourceMtime;
+	if(!statSource(sourcePath, sourceSize, sourceMtime)) return true; // shipped without the text wordlist
+	return sourceSize == header->sourceSize && sourceMtime == header->sourceMtime;
+}
+
+bool WordIndex::write(const std::string& path, const std::string& sourcePath, const char* text, const uint32_t* offsets,
+	uint32_t wordCount, const double* scores, const int* levels, const uint32_t* lengthStarts, uint32_t maxLength,
+	const uint32_t* lengthRanks, const uint32_t* rankSlots, uint32_t rankSlotCount, const uint32_t* postingStarts,
+	const uint32_t* postingRanks, const uint64_t* bitsetStarts, const uint64_t* bitsets){
+	WordIndexHeader header = WordIndexHeader();
+	header.magic = WORD_INDEX_MAGIC;
+	header.version = WORD_INDEX_VERSION;
+	if(!statSource(sourcePath, header.sourceSize, header.sourceMtime)){
+		std::cerr << "Error: Could not stat '" << sourcePath << "'." << std::endl;
+		return false;
+	}
+	header.wordCount = wordCount;
+	header.numLevels = NUM_LEVELS;
+	header.minLetters = MIN_LETTERS;
+	header.maxLength = maxLength;
+	header.rankSlotCount = rankSlotCount;
+	header.postingCount = postingStarts[postingSlotCount(maxLength)];
+	header.textSize = offsets[wordCount];
+	header.bitsetWordCount = bitsetStarts[maxLength + 1];
+
+	// Lay the whole file out in memory, then write it under a temporary name and rename it
+	// over the old index, so a running server never maps a half-written file.
+	size_t sections[11];
+	std::vector<char> file(layoutIndex(header.wordCount, header.numLevels, header.maxLength, header.rankSlotCount, header.postingCount,
+		header.bitsetWordCount, header.textSize, sections), '\0');
+	std::memcpy(&file[0], &header, sizeof(header));
+	std::memcpy(&file[sections[0]], scores, sizeof(double) * wordCount);
+	for(unsigned int i = 0; i <= NUM_LEVELS; i++){
+		uint32_t level = (uint32_t)levels[i];
+		std::memcpy(&file[sections[1] + sizeof(uint32_t) * i], &level, sizeof(level));
+	}
+	std::memcpy(&file[sections[2]], offsets, sizeof(uint32_t) * ((size_t)wordCount + 1));
+	std::memcpy(&file[sections[3]], lengthStarts, sizeof(uint32_t) * ((size_t)maxLength + 2));
+	std::memcpy(&file[sections[4]], lengthRanks, sizeof(uint32_t) * wordCount);
+	std::memcpy(&file[sections[5]], rankSlots, sizeof(uint32_t) * (size_t)rankSlotCount);
+	std::memcpy(&file[sections[6]], postingStarts, sizeof(uint32_t) * (postingSlotCount(maxLength) + 1));
+	std::memcpy(&file[sections[7]], postingRanks, sizeof(uint32_t) * (size_t)header.postingCount);
+	std::memcpy(&file[sections[8]], bitsetStarts, sizeof(uint64_t) * ((size_t)maxLength + 2));
+	std::memcpy(&file[sections[9]], bitsets, sizeof(uint64_t) * (size_t)header.bitsetWordCount);
+	std::memcpy(&file[sections[10]], text, header.textSize);
+
+	const std::string tmp = path + ".tmp";
+	FILE* out = fopen(tmp.c_str(), "wb");
+	if(!out){
+		std::cerr << "Error: Could not open '" << tmp << "' for writing." << std::endl;
+		return false;
+	}
+	bool ok = (fwrite(&file[0], 1, file.size(), out) == file.size());
+	ok = (fclose(out) == 0) && ok;
+	if(!ok || rename(tmp.c_str(), path.c_str()) != 0){
+		std::cerr << "Error: Could not write '" << path << "'." << std::endl;
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,100 @@
+#ifndef WORDINDEX_INC
+#define WORDINDEX_INC
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#define WORD_INDEX_MAGIC 0x494C5748 // "HWLI"
+#define WORD_INDEX_VERSION 4 // bump whenever the layout or the scoring changes
+
+static const std::string WORDLIST_INDEX_PATH = "./wordlist.idx";
+
+// Posting lists: for every word length L, position p < L and letter c, one list of the ranks
+// of the words of length L with c at p. The lists are stored back to back, in this slot order.
+inline size_t postingSlot(unsigned int length, unsigned int position, unsigned int letter){
+	return ((size_t)length * (length - 1) / 2 + position) * 26 + letter;
+}
+inline size_t postingSlotCount(unsigned int maxLength){
+	return postingSlot(maxLength + 1, 0, 0);
+}
+
+// On-disk layout of a wordlist index (native byte order, every section 8-byte aligned):
+//	WordIndexHeader
+//	double   scores[wordCount]             by rank (0 = easiest)
+//	uint32_t levels[numLevels + 1]         first rank of each level
+//	uint32_t offsets[wordCount + 1]        start of each word in text
+//	uint32_t lengthStarts[maxLength + 2]   lengthRanks[lengthStarts[L] .. lengthStarts[L + 1]) are the words of length L
+//	uint32_t lengthRanks[wordCount]        ranks grouped by length, ascending within each group
+//	uint32_t rankSlots[rankSlotCount]      open-addressed hash table of rank + 1 by word (0 = empty)
+//	uint32_t postingStarts[postingSlotCount(maxLength) + 1]   postingRanks[postingStarts[s] .. postingStarts[s + 1]) is the list of slot s
+//	uint32_t postingRanks[postingCount]    ranks, ascending within each list
+//	uint64_t bitsetStarts[maxLength + 2]   bitsets[bitsetStarts[L] .. bitsetStarts[L + 1]) are the bit rows of length L
+//	uint64_t bitsets[bitsetWordCount]      see Wordlist::wordsWithLetter
+//	char     text[textSize]                the words by rank, each followed by '\0'
+struct WordIndexHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceSize; // size of the wordlist it was built from
+	int64_t sourceMtime; // modification time of that wordlist
+	uint32_t wordCount;
+	uint32_t numLevels; // NUM_LEVELS when built
+	uint32_t minLetters; // MIN_LETTERS when built
+	uint32_t maxLength; // length of the longest word
+	uint32_t rankSlotCount; // size of the rank table (a power of two, more than wordCount)
+	uint32_t postingCount; // total length of the posting lists
+	uint64_t textSize;
+	uint64_t bitsetWordCount; // total size of the bit rows, in 64-bit words
+};
+
+// Read-only view of a wordlist index mapped into memory. Opening it costs a few page-table
+// entries rather than a parse, and the pages are shared by every process that maps the file.
+class WordIndex {
+	private:
+		void* base = nullptr;
+		size_t size = 0;
+		const WordIndexHeader* header = nullptr;
+		const double* scores = nullptr;
+		const uint32_t* levels = nullptr;
+		const uint32_t* offsets = nullptr;
+		const uint32_t* lengthStarts = nullptr;
+		const uint32_t* lengthRanks = nullptr;
+		const uint32_t* rankSlots = nullptr;
+		const uint32_t* postingStarts = nullptr;
+		const uint32_t* postingRanks = nullptr;
+		const uint64_t* bitsetStarts = nullptr;
+		const uint64_t* bitsets = nullptr;
+		const char* text = nullptr;
+
+		void close();
+	public:
+		WordIndex(){ }
+		~WordIndex(){ close(); }
+		WordIndex(const WordIndex&) = delete;
+		WordIndex& operator=(const WordIndex&) = delete;
+
+		bool open(const std::string& path); // map the file and check that its layout is consistent
+		bool matchesSource(const std::string& sourcePath); // built from this wordlist with this build's settings
+		uint32_t getWordCount(){ return header->wordCount; }
+		uint32_t getMaxLength(){ return header->maxLength; }
+		const char* getText(){ return text; }
+		const uint32_t* getOffsets(){ return offsets; }
+		const double* getScores(){ return scores; }
+		const uint32_t* getLevels(){ return levels; }
+		const uint32_t* getLengthStarts(){ return lengthStarts; }
+		const uint32_t* getLengthRanks(){ return lengthRanks; }
+		const uint32_t* getRankSlots(){ return rankSlots; }
+		uint32_t getRankSlotCount(){ return header->rankSlotCount; }
+		const uint32_t* getPostingStarts(){ return postingStarts; }
+		const uint32_t* getPostingRanks(){ return postingRanks; }
+		const uint64_t* getBitsetStarts(){ return bitsetStarts; }
+		const uint64_t* getBitsets(){ return bitsets; }
+
+		// Write an index for a ranked wordlist (arrays laid out as in the file), stamped with the source file.
+		static bool write(const std::string& path, const std::string& sourcePath, const char* text, const uint32_t* offsets,
+			uint32_t wordCount, const double* scores, const int* levels, const uint32_t* lengthStarts, uint32_t maxLength,
+			const uint32_t* lengthRanks, const uint32_t* rankSlots, uint32_t rankSlotCount, const uint32_t* postingStarts,
+			const uint32_t* postingRanks, const uint64_t* bitsetStarts, const uint64_t* bitsets);
+};
+
+#endif
@@ -1,14 +1,18 @@
 #include "Words.h"
+#include "WordIndex.h"
+#include "Letters.h"
+#include "Random.h"
 #include <iomanip>
 #include <stdexcept>
 #include <cctype>
 #include <algorithm>
-#include <random>
+#include <functional>
+#include <thread>
 
 Wordlist::Wordlist(){
-	for(std::pair<std::string, double> pair : LETTER_FREQUENCIES){
-		frequencies[std::tolower(std::get<0>(pair)[0])] = std::get<1>(pair);
-	}
+	arenaOffsets.assign(1, 0U);
+	arenaLengthStarts.assign(2, 0U);
+	useArena();
 }
 
 std::string Wordlist::dispProgress(int at, int total, std::string message, std::string style, int metering, int increment, bool silent){
@@ -43,13 +47,13 @@ std::string Wordlist::dispProgress(int at, int total, std::string message, std::
 
 // trim from start
 static inline std::string &ltrim(std::string &s) {
-        s.erase(s.begin(), std::find_if(s.begin(), s.end(), std::not1(std::ptr_fun<int, int>(std::isspace))));
+        s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char c){ return !std::isspace(c); }));
         return s;
 }
 
 // trim from end
 static inline std::string &rtrim(std::string &s) {
-        s.erase(std::find_if(s.rbegin(), s.rend(), std::not1(std::ptr_fun<int, int>(std::isspace))).base(), s.end());
+        s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char c){ return !std::isspace(c); }).base(), s.end());
         return s;
 }
 
@@ -65,20 +69,7 @@ bool Wordlist::readWordlist(std::string filename){
 	try {
 		std::ifstream ifp(filename.c_str());
 		if(!ifp.is_open()) throw "Could not open wordlist at " + filename + "!";
-		std::string tmp;
-		while(ifp >> tmp){
-			// Skip contractions and empty lines.
-			tmp = trim(tmp);
-			if(!tmp.length()) continue;
-			if(tmp.find('\'') != std::string::npos) continue;
-			if(tmp.length() < MIN_LETTERS) continue;
-
-			// Transform to lowercase.
-			std::transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
-
-			// Finally, save the word.
-			words.push_back(tmp);
-		}
+		readWordlist(ifp);
 	} catch(std::string e){
 		std::cout << e << std::endl;
 		return false;
@@ -86,109 +77,371 @@ bool Wordlist::readWordlist(std::string filename){
 	return true;
 }
 
-inline bool Wordlist::isVowel(char ch){
-	ch = (std::islower(ch) ? ch : std::tolower(ch));
-	return (ch == 'a') || (ch == 'e') || (ch == 'i') || (ch == 'o') || (ch == 'u');
+void Wordlist::readWordlist(std::istream& ifp){
+	index.reset();
+	arena.clear();
+	arenaOffsets.assign(1, 0U);
+	std::string tmp;
+	while(ifp >> tmp){
+		// Skip contractions and empty lines.
+		tmp = trim(tmp);
+		if(!tmp.length()) continue;
+		if(tmp.find('\'') != std::string::npos) continue;
+		if(tmp.length() < MIN_LETTERS) continue;
+
+		// Transform to lowercase.
+		std::transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+
+		// Finally, append the word to the arena.
+		arena.insert(arena.end(), tmp.begin(), tmp.end());
+		arena.push_back('\0');
+		arenaOffsets.push_back((uint32_t)arena.size());
+	}
+	arenaScores.assign(arenaOffsets.size() - 1, 0.0);
+	arenaLengthStarts.assign(2, 0U); // until scoreWords
+	arenaLengthRanks.clear();
+	arenaRankSlots.clear(); // until scoreWords
+	arenaPostingStarts.assign(postingSlotCount(0) + 1, 0U);
+	arenaPostingRanks.clear();
+	arenaBitsetStarts.assign(2, 0U);
+	arenaBitsets.clear();
+	useArena();
+}
+
+void Wordlist::useArena(){
+	text = arena.data();
+	offsets = arenaOffsets.data();
+	scores = arenaScores.data();
+	wordCount = (uint32_t)arenaOffsets.size() - 1;
+	lengthStarts = arenaLengthStarts.data();
+	lengthRanks = arenaLengthRanks.data();
+	maxLength = (uint32_t)arenaLengthStarts.size() - 2;
+	rankSlots = arenaRankSlots.data();
+	rankSlotCount = (uint32_t)arenaRankSlots.size();
+	postingStarts = arenaPostingStarts.data();
+	postingRanks = arenaPostingRanks.data();
+	bitsetStarts = arenaBitsetStarts.data();
+	bitsets = arenaBitsets.data();
 }
 
 void Wordlist::initLevels(void){
-	int diff = (int)words.size() / NUM_LEVELS;
+	int diff = (int)wordCount / NUM_LEVELS;
 	for(int i = 0; i < NUM_LEVELS; i++){
 		levelIndices[i] = diff * i;
 	}
-	levelIndices[NUM_LEVELS] = (int)words.size();
+	levelIndices[NUM_LEVELS] = (int)wordCount;
 }
 
-void Wordlist::scoreWords(void){
-	// Assign a score to each word.
-	double score;
-	unsigned int length, totalSize = words.size();
-	for(unsigned int c = 0; c < totalSize; c++){
-		std::string& word = words[c];
-
-		// First, calculate the score based on the mean letter frequency and
-		// adjust if no vowels.
-		score = 0.0;
-		length = word.length();
-		bool hasVowels = false;
-		for(unsigned int i = 0; i < length; i++){
-			char on = word[i];
-			hasVowels |= isVowel(on);
-			score += frequencies[on];
+void Wordlist::initLengths(void){
+	// Counting sort of the ranks by word length.
+	WordRange words = getSortedWords();
+	size_t longest = 0;
+	for(std::string_view word : words) longest = std::max(longest, word.length());
+	arenaLengthStarts.assign(longest + 2, 0U);
+	for(std::string_view word : words) ++arenaLengthStarts[word.length() + 1];
+	for(size_t i = 1; i < arenaLengthStarts.size(); i++) arenaLengthStarts[i] += arenaLengthStarts[i - 1];
+	arenaLengthRanks.resize(wordCount);
+	std::vector<uint32_t> next(arenaLengthStarts.begin(), arenaLengthStarts.end() - 1);
+	for(uint32_t rank = 0; rank < wordCount; rank++){
+		arenaLengthRanks[next[words[rank].length()]++] = rank;
+	}
+}
+
+// FNV-1a; words are short, so this beats std::hash here.
+static inline uint32_t hashWord(std::string_view word){
+	uint32_t hash = 2166136261U;
+	for(char c : word){
+		hash ^= (unsigned char)c;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+void Wordlist::initRanks(void){
+	// Linear probing in a table at most half full.
+	size_t size = 2;
+	while(size < 2 * (size_t)wordCount) size *= 2;
+	arenaRankSlots.assign(size, 0U);
+	WordRange words = getSortedWords();
+	for(uint32_t rank = 0; rank < wordCount; rank++){
+		size_t slot = hashWord(words[rank]) & (size - 1);
+		while(arenaRankSlots[slot]) slot = (slot + 1) & (size - 1);
+		arenaRankSlots[slot] = rank + 1;
+	}
+}
+
+long Wordlist::getRank(std::string_view word) const {
+	if(!rankSlotCount) return -1;
+	WordRange words = getSortedWords();
+	size_t mask = rankSlotCount - 1;
+	for(size_t slot = hashWord(word) & mask; rankSlots[slot]; slot = (slot + 1) & mask){
+		if(words[rankSlots[slot] - 1] == word) return (long)rankSlots[slot] - 1;
+	}
+	return -1;
+}
+
+void Wordlist::initPostings(void){
+	// Counting sort of (length, position, letter) over the length buckets, whose ranks are
+	// ascending, so every list comes out ascending too.
+	WordRange words = getSortedWords();
+	arenaPostingStarts.assign(postingSlotCount(maxLength) + 1, 0U);
+	for(unsigned int length = 1; length <= maxLength; length++){
+		for(const uint32_t* rank = ranksOfLengthBegin(length); rank != ranksOfLengthEnd(length); ++rank){
+			std::string_view word = words[*rank];
+			for(unsigned int i = 0; i < length; i++){
+				if(letterBit(word[i])) ++arenaPostingStarts[postingSlot(length, i, word[i] - 'a') + 1];
+			}
 		}
-		score /= (double)length;
+	}
+	for(size_t i = 1; i < arenaPostingStarts.size(); i++) arenaPostingStarts[i] += arenaPostingStarts[i - 1];
+	arenaPostingRanks.resize(arenaPostingStarts.back());
+	std::vector<uint32_t> next(arenaPostingStarts.begin(), arenaPostingStarts.end() - 1);
+	for(unsigned int length = 1; length <= maxLength; length++){
+		for(const uint32_t* rank = ranksOfLengthBegin(length); rank != ranksOfLengthEnd(length); ++rank){
+			std::string_view word = words[*rank];
+			for(unsigned int i = 0; i < length; i++){
+				if(letterBit(word[i])) arenaPostingRanks[next[postingSlot(length, i, word[i] - 'a')]++] = *rank;
+			}
+		}
+	}
+}
 
-		// Adjust if no vowels.
-		if(!hasVowels){
-			score *= 0.75; // lower = harder
+void Wordlist::initBitsets(void){
+	// Per length: 26 rows for "has the letter anywhere", then 26 for each position.
+	WordRange words = getSortedWords();
+	arenaBitsetStarts.assign(maxLength + 2, 0U);
+	for(unsigned int length = 0; length <= maxLength; length++){
+		arenaBitsetStarts[length + 1] = arenaBitsetStarts[length] + 26 * (length + 1) * getBitsetRowWords(length);
+	}
+	arenaBitsets.assign(arenaBitsetStarts[maxLength + 1], 0U);
+	for(unsigned int length = 1; length <= maxLength; length++){
+		const size_t rowWords = getBitsetRowWords(length);
+		uint64_t* block = arenaBitsets.data() + arenaBitsetStarts[length];
+		const uint32_t* ranks = ranksOfLengthBegin(length);
+		for(size_t j = 0; ranks + j != ranksOfLengthEnd(length); j++){
+			std::string_view word = words[ranks[j]];
+			const uint64_t bit = 1ULL << (j % 64);
+			for(unsigned int i = 0; i < length; i++){
+				if(!letterBit(word[i])) continue;
+				block[(word[i] - 'a') * rowWords + j / 64] |= bit;
+				block[(26 * (i + 1) + (word[i] - 'a')) * rowWords + j / 64] |= bit;
+			}
 		}
+	}
+}
+
+void Wordlist::matchPattern(const std::string& pattern, LetterMask excluded, std::vector<uint32_t>& out) const {
+	out.clear();
+	const unsigned int length = (unsigned int)pattern.length();
+	if(length == 0 || length > maxLength) return;
+
+	// The candidates are the intersection of the lists of the known letters (the whole length
+	// bucket if none is known), driven by the shortest list.
+	std::vector<std::pair<const uint32_t*, const uint32_t*> > lists;
+	for(unsigned int i = 0; i < length; i++){
+		if(pattern[i] == '_') continue;
+		if(!letterBit(pattern[i])) return; // no word has anything else at a known position
+		size_t slot = postingSlot(length, i, pattern[i] - 'a');
+		lists.push_back(std::make_pair(postingRanks + postingStarts[slot], postingRanks + postingStarts[slot + 1]));
+	}
+	if(lists.empty()) lists.push_back(std::make_pair(ranksOfLengthBegin(length), ranksOfLengthEnd(length)));
+	std::sort(lists.begin(), lists.end(), [](const std::pair<const uint32_t*, const uint32_t*>& a, const std::pair<const uint32_t*, const uint32_t*>& b){
+		return std::get<1>(a) - std::get<0>(a) < std::get<1>(b) - std::get<0>(b);
+	});
 
-		// Then, account for length (lower length implies a harder word).
-		// Scaling Function: f(x) = 0.5x(x + 1)
-		score *= 0.5 * length * (length + 1);
-		score = std::max(0.0, score);
+	WordRange words = getSortedWords();
+	for(const uint32_t* rank = std::get<0>(lists[0]); rank != std::get<1>(lists[0]); ++rank){
+		bool works = true;
+		for(size_t l = 1; works && l < lists.size(); l++){
+			// The lists are ascending and so are the candidates, so each search starts where the last one stopped.
+			std::get<0>(lists[l]) = std::lower_bound(std::get<0>(lists[l]), std::get<1>(lists[l]), *rank);
+			works = (std::get<0>(lists[l]) != std::get<1>(lists[l]) && *std::get<0>(lists[l]) == *rank);
+		}
+		if(!works) continue;
+		if(excluded){
+			std::string_view word = words[*rank];
+			for(unsigned int i = 0; works && i < length; i++){
+				if(pattern[i] == '_' && (excluded & letterBit(word[i]))) works = false;
+			}
+			if(!works) continue;
+		}
+		out.push_back(*rank);
+	}
+}
 
-		// And save the score as well as displaying our progress.
-		scores[word] = score;
-		dispProgress(int(c + 1), int(totalSize), /*message=*/"Scoring words", /*style=*/"percent", /*metering=*/100);
+bool Wordlist::loadIndex(std::string filename, std::string source){
+	std::unique_ptr<WordIndex> mapped(new WordIndex());
+	if(!mapped->open(filename)) return false;
+	if(!mapped->matchesSource(source)){
+		std::cerr << "Warning: '" << filename << "' is older than '" << source << "'; reading the text wordlist instead (rebuild it with 'make wordlist.idx')." << std::endl;
+		return false;
 	}
 
-	// Sort words based on their score. //
-	// Alert user to operation.
-	std::cout << "Sorting words... ";
+	// Use the mapped file in place; nothing is copied.
+	index = std::move(mapped);
+	arena.clear();
+	arenaOffsets.clear();
+	arenaScores.clear();
+	arenaLengthStarts.clear();
+	arenaLengthRanks.clear();
+	arenaRankSlots.clear();
+	arenaPostingStarts.clear();
+	arenaPostingRanks.clear();
+	arenaBitsetStarts.clear();
+	arenaBitsets.clear();
+	text = index->getText();
+	offsets = index->getOffsets();
+	scores = index->getScores();
+	wordCount = index->getWordCount();
+	lengthStarts = index->getLengthStarts();
+	lengthRanks = index->getLengthRanks();
+	maxLength = index->getMaxLength();
+	rankSlots = index->getRankSlots();
+	rankSlotCount = index->getRankSlotCount();
+	postingStarts = index->getPostingStarts();
+	postingRanks = index->getPostingRanks();
+	bitsetStarts = index->getBitsetStarts();
+	bitsets = index->getBitsets();
+	for(unsigned int i = 0; i <= NUM_LEVELS; i++) levelIndices[i] = (int)index->getLevels()[i];
+	return true;
+}
+
+bool Wordlist::writeIndex(std::string filename, std::string source) const {
+	return WordIndex::write(filename, source, text, offsets, wordCount, scores, levelIndices, lengthStarts, maxLength, lengthRanks, rankSlots, rankSlotCount,
+		postingStarts, postingRanks, bitsetStarts, bitsets);
+}
+
+// Run fn(begin, end) over [0, n) split into one contiguous chunk per core.
+static void parallelFor(size_t n, const std::function<void(size_t, size_t)>& fn){
+	size_t threads = std::max(1U, std::thread::hardware_concurrency());
+	if(n < WORDLIST_PARALLEL_CUTOFF || threads == 1){
+		fn(0, n);
+		return;
+	}
+	threads = std::min(threads, n / (WORDLIST_PARALLEL_CUTOFF / 4));
+	std::vector<std::thread> workers;
+	for(size_t t = 1; t < threads; t++){
+		workers.push_back(std::thread(fn, n * t / threads, n * (t + 1) / threads));
+	}
+	fn(0, n / threads);
+	for(std::thread& worker : workers) worker.join();
+}
+
+// Sort with one chunk per core, then merge the sorted chunks pairwise, also in parallel.
+template <typename T, typename Compare>
+static void parallelSort(std::vector<T>& items, Compare less){
+	size_t threads = std::max(1U, std::thread::hardware_concurrency());
+	if(items.size() < WORDLIST_PARALLEL_CUTOFF || threads == 1){
+		std::sort(items.begin(), items.end(), less);
+		return;
+	}
+	std::vector<size_t> bounds;
+	for(size_t t = 0; t <= threads; t++) bounds.push_back(items.size() * t / threads);
+	std::vector<std::thread> sorts;
+	for(size_t t = 0; t < threads; t++){
+		sorts.push_back(std::thread([&items, &less, &bounds, t]{
+			std::sort(items.begin() + bounds[t], items.begin() + bounds[t + 1], less);
+		}));
+	}
+	for(std::thread& sort : sorts) sort.join();
+	for(size_t width = 1; width < threads; width *= 2){
+		std::vector<std::thread> merges;
+		for(size_t t = 0; t + width < threads; t += 2 * width){
+			size_t first = bounds[t], middle = bounds[t + width], last = bounds[std::min(t + 2 * width, threads)];
+			merges.push_back(std::thread([&items, &less, first, middle, last]{
+				std::inplace_merge(items.begin() + first, items.begin() + middle, items.begin() + last, less);
+			}));
+		}
+		for(std::thread& merge : merges) merge.join();
+	}
+}
+
+// Score of a word: higher is easier, lower is harder.
+static double scoreWord(std::string_view word){
+	// First, calculate the score based on the mean letter frequency and
+	// adjust if no vowels.
+	double score = 0.0;
+	unsigned int length = word.length();
+	LetterMask letters = 0;
+	for(unsigned int i = 0; i < length; i++){
+		unsigned int ind = (unsigned char)word[i] - 'a';
+		if(ind >= 26) continue; // not a letter
+		letters |= (LetterMask)1 << ind;
+		score += LETTER_FREQUENCIES[ind];
+	}
+	score /= (double)length;
+
+	// Adjust if no vowels.
+	if(!(letters & LETTER_MASK_VOWELS)){
+		score *= 0.75; // lower = harder
+	}
+
+	// Then, account for length (lower length implies a harder word).
+	// Scaling Function: f(x) = 0.5x(x + 1)
+	score *= 0.5 * length * (length + 1);
+	return std::max(0.0, score);
+}
+
+void Wordlist::scoreWords(void){
+	// Assign a score to each word, spread across cores.
+	const unsigned int totalSize = wordCount;
+	WordRange words = getSortedWords();
+	std::vector<std::pair<double, uint32_t> > items(totalSize); // (score, position in arena)
+	std::cout << "Scoring " << totalSize << " words... ";
 	std::cout.flush();
+	parallelFor(totalSize, [&](size_t begin, size_t end){
+		for(size_t c = begin; c < end; c++){
+			items[c] = std::make_pair(scoreWord(words[c]), (uint32_t)c);
+		}
+	});
 
-	// Copy over the map as pairs of values into a vector and sort that vector by value.
-	std::vector<std::pair<std::string, double> > items;
-	items.clear();
-	std::copy(scores.begin(), scores.end(), std::back_inserter(items));
-	std::sort(items.begin(), items.end(), [](std::pair<std::string, double>& a, std::pair<std::string, double>& b){
-		return std::get<1>(a) > std::get<1>(b);
+	// Sort by score (ties alphabetically, so duplicates end up next to each other).
+	parallelSort(items, [&words](const std::pair<double, uint32_t>& a, const std::pair<double, uint32_t>& b){
+		if(std::get<0>(a) != std::get<0>(b)) return std::get<0>(a) > std::get<0>(b);
+		return words[std::get<1>(a)] < words[std::get<1>(b)];
 	});
 
-	// Copy back into original words vector, overwriting.
-	words.clear();
+	// Rebuild the arena in rank order, dropping duplicates.
+	std::vector<char> ranked;
+	std::vector<uint32_t> rankedOffsets(1, 0U);
+	std::vector<double> rankedScores;
+	ranked.reserve(arena.size());
+	rankedOffsets.reserve(arenaOffsets.size());
+	rankedScores.reserve(totalSize);
 	for(unsigned int i = 0, e = items.size(); i < e; i++){
-		std::string& word = std::get<0>(items[i]);
-		words.push_back(word);
+		std::string_view word = words[std::get<1>(items[i])];
+		if(i > 0 && word == words[std::get<1>(items[i - 1])]) continue;
+		ranked.insert(ranked.end(), word.begin(), word.end());
+		ranked.push_back('\0');
+		rankedOffsets.push_back((uint32_t)ranked.size());
+		rankedScores.push_back(std::get<0>(items[i]));
 	}
+	arena.swap(ranked);
+	arenaOffsets.swap(rankedOffsets);
+	arenaScores.swap(rankedScores);
+	useArena();
 
 	// Update user.
 	std::cout << "done." << std::endl;
-	std::cout.flush();
-	/*
-	for(unsigned int i = 0; i < 20; i++){
-		printf("(%s, %f) ", words[i].c_str(), scores[words[i]]);
-	}
-	std::cout << std::endl;
-	*/
 
 	// Initialize level data.
 	initLevels();
+	initLengths();
+	initRanks();
+	useArena();
+	initPostings(); // reads the length buckets through the views
+	initBitsets();
+	useArena();
 }
 
-std::string Wordlist::getWordAtLevel(unsigned int level){
+std::string Wordlist::getWordAtLevel(unsigned int level) const {
 	/*
 	start_ind, end_ind = word_stats["levels"][level - 1], word_stats["levels"][level]
 	rand_ind = random.randrange(start_ind, end_ind)
 	return sorted_words[rand_ind]
 	*/
-	int start_ind = levelIndices[level - 1], end_ind = levelIndices[level];
-	std::random_device rd;
-	std::mt19937 rng(rd());
-	std::uniform_int_distribution<int> randGenerator(start_ind, end_ind);
-	auto rand_ind = randGenerator(rng);
-	return words[rand_ind];
+	uint32_t start_ind = getLevelBegin(level), end_ind = getLevelEnd(level); // [start_ind, end_ind)
+	if(start_ind == end_ind) return "";
+	uint32_t rand_ind = start_ind + threadRandom().below(end_ind - start_ind);
+	return std::string(getSortedWords()[rand_ind]);
 }
-
-
-
-
-
-
-
-
-
-
-
-
@@ -11,63 +11,141 @@
 #include <mutex>
 #include <atomic>
 #include <thread>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <string_view>
+#include <iterator>
+#include "WordIndex.h"
+#include "Letters.h"
+#include "Bitset.h"
 #include "../../libairplay/include/airplay_browser.hpp"
 #include "../../libairplay/include/airplay_device.hpp"
 
 #define NUM_LEVELS 20
 #define GUESS_LIMIT 7
 #define MIN_LETTERS 5
+#define WORDLIST_PARALLEL_CUTOFF 16384 // below this many words, scoring and sorting stay on one thread
 
 // Constants //
 static const std::string WORDLIST_PATH = "./wordlist.txt";
-static std::map<std::string, double> LETTER_FREQUENCIES = {
-	{"E", 12.02},
-	{"T", 9.10},
-	{"A", 8.12},
-	{"O", 7.68},
-	{"I", 7.31},
-	{"N", 6.95},
-	{"S", 6.28},
-	{"R", 6.02},
-	{"H", 5.92},
-	{"D", 4.32},
-	{"L", 3.98},
-	{"U", 2.88},
-	{"C", 2.71},
-	{"M", 2.61},
-	{"F", 2.30},
-	{"Y", 2.11},
-	{"W", 2.09},
-	{"G", 2.03},
-	{"P", 1.82},
-	{"B", 1.49},
-	{"V", 1.11},
-	{"K", 0.69},
-	{"X", 0.17},
-	{"Q", 0.11},
-	{"J", 0.10},
-	{"Z", 0.07}
+// Relative frequency (%) of each letter in English text, indexed by letter - 'a'.
+static constexpr double LETTER_FREQUENCIES[26] = {
+	8.12, 1.49, 2.71, 4.32, 12.02, 2.30, 2.03, 5.92, 7.31, 0.10, 0.69, 3.98, 2.61, 6.95, 7.68, 1.82, 0.11, 6.02, 6.28, 9.10, 2.88, 1.11, 2.09, 0.17, 2.11, 0.07
 };
 
-// Wordlist class.
+// Read-only, random-access view of the ranked words, as string_views into one
+// contiguous arena of '\0'-terminated words.
+class WordRange {
+	private:
+		const char* text;
+		const uint32_t* offsets; // start of each word in text, plus the end of the last one
+		uint32_t count;
+	public:
+		class iterator {
+			private:
+				const char* text;
+				const uint32_t* offset;
+			public:
+				typedef std::random_access_iterator_tag iterator_category;
+				typedef std::string_view value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef const std::string_view* pointer;
+				typedef std::string_view reference;
+
+				iterator(const char* t, const uint32_t* o) : text(t), offset(o){ }
+				std::string_view operator*() const { return std::string_view(text + offset[0], offset[1] - offset[0] - 1); }
+				std::string_view operator[](difference_type n) const { return *(*this + n); }
+				iterator& operator++(){ ++offset; return *this; }
+				iterator operator++(int){ iterator ret = *this; ++offset; return ret; }
+				iterator& operator--(){ --offset; return *this; }
+				iterator operator--(int){ iterator ret = *this; --offset; return ret; }
+				iterator& operator+=(difference_type n){ offset += n; return *this; }
+				iterator& operator-=(difference_type n){ offset -= n; return *this; }
+				iterator operator+(difference_type n) const { return iterator(text, offset + n); }
+				iterator operator-(difference_type n) const { return iterator(text, offset - n); }
+				difference_type operator-(const iterator& o) const { return offset - o.offset; }
+				bool operator==(const iterator& o) const { return offset == o.offset; }
+				bool operator!=(const iterator& o) const { return offset != o.offset; }
+				bool operator<(const iterator& o) const { return offset < o.offset; }
+		};
+
+		WordRange(const char* t, const uint32_t* o, uint32_t c) : text(t), offsets(o), count(c){ }
+		iterator begin() const { return iterator(text, offsets); }
+		iterator end() const { return iterator(text, offsets + count); }
+		size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+		std::string_view operator[](size_t rank) const { return std::string_view(text + offsets[rank], offsets[rank + 1] - offsets[rank] - 1); }
+};
+
+// Wordlist class. All words live in one character arena (or in the mapped index file),
+// addressed by offset, with the scores and length buckets in parallel arrays.
 class Wordlist {
 	private:
-		std::map<char, double> frequencies; // letter --> frequency
-		std::vector<std::string> words; // sorted from easiest --> hardest (in ascending order)
-		std::map<std::string, double> scores; // word --> score (higher is easier, lower is harder)
 		int levelIndices[NUM_LEVELS + 1]; // leveling data
+
+		// Storage owned when read from text.
+		std::vector<char> arena; // every word followed by '\0'; in rank order once scored
+		std::vector<uint32_t> arenaOffsets; // start of each word in arena, plus the end
+		std::vector<double> arenaScores; // score of each word by rank (higher is easier, lower is harder)
+		std::vector<uint32_t> arenaLengthStarts, arenaLengthRanks; // length buckets, see lengthStarts
+		std::vector<uint32_t> arenaRankSlots; // rank table, see rankSlots
+		std::vector<uint32_t> arenaPostingStarts, arenaPostingRanks; // posting lists, see postingStarts
+		std::vector<uint64_t> arenaBitsetStarts, arenaBitsets; // bit rows, see bitsetStarts
+		std::unique_ptr<WordIndex> index; // mapped storage when loaded from a precompiled index
+
+		// Views of whichever storage is in use.
+		const char* text = nullptr;
+		const uint32_t* offsets = nullptr;
+		const double* scores = nullptr;
+		uint32_t wordCount = 0;
+		const uint32_t* lengthStarts = nullptr; // lengthRanks[lengthStarts[L] .. lengthStarts[L + 1]) are the words of length L
+		const uint32_t* lengthRanks = nullptr; // ranks grouped by length, ascending within each group
+		uint32_t maxLength = 0; // longest word
+		const uint32_t* rankSlots = nullptr; // open-addressed hash table of rank + 1 by word (0 = empty), see getRank
+		uint32_t rankSlotCount = 0; // size of rankSlots (a power of two, or 0 before scoring)
+		const uint32_t* postingStarts = nullptr; // postingRanks[postingStarts[postingSlot(L, p, c)] .. + 1]) are the words of length L with letter c at p
+		const uint32_t* postingRanks = nullptr; // ranks, ascending within each list
+		const uint64_t* bitsetStarts = nullptr; // bitsets[bitsetStarts[L] .. bitsetStarts[L + 1]) are the bit rows of length L
+		const uint64_t* bitsets = nullptr; // see wordsWithLetter
 		
-		inline bool isVowel(char ch); // return if the specified character is a vowel
+		void useArena(); // point the views at the owned storage
 		void initLevels(); // initialize level data
+		void initLengths(); // initialize length buckets
+		void initRanks(); // build the word --> rank table
+		void initPostings(); // build the per-position letter lists
+		void initBitsets(); // build the bit rows
 	public:
 		Wordlist();
 		~Wordlist(){ }
 		
 		std::string dispProgress(int at, int total, std::string message="Progress", std::string style="percent", int metering=-1, int increment=5, bool silent=false); // display progress in multiple ways
 		bool readWordlist(std::string filename); // read wordlist
-		std::vector<std::string>& getSortedWords(){ return words; } // return sorted wordlist
+		void readWordlist(std::istream& in); // read wordlist from a stream
+		bool loadIndex(std::string filename, std::string source); // map a precompiled index of source instead of reading and scoring it
+		bool writeIndex(std::string filename, std::string source) const; // save the scored wordlist as an index of source
+		WordRange getSortedWords() const { return WordRange(text, offsets, wordCount); } // words sorted from easiest --> hardest
+		double getScore(uint32_t rank) const { return scores[rank]; } // score of the word at a rank
+		long getRank(std::string_view word) const; // rank of a word, or -1 if it is not in the list
+		bool contains(std::string_view word) const { return getRank(word) >= 0; } // whether a word is in the list
+		// Ranks of the words with the given length, in ascending order.
+		const uint32_t* ranksOfLengthBegin(unsigned int length) const { return lengthRanks + lengthStarts[std::min(length, maxLength + 1)]; }
+		const uint32_t* ranksOfLengthEnd(unsigned int length) const { return lengthRanks + lengthStarts[std::min(length + 1, maxLength + 1)]; }
+		bool hasLength(unsigned int length) const { return ranksOfLengthBegin(length) != ranksOfLengthEnd(length); }
+		// Ranks, ascending, of the words that fit pattern: the same length, the letter pattern[i] at each position
+		// where it is not '_', and none of the letters in excluded at the '_' positions. Only the words that have
+		// the known letters in place are visited.
+		void matchPattern(const std::string& pattern, LetterMask excluded, std::vector<uint32_t>& out) const;
+		// Bit rows over the words of one length (1 to the longest word): bit j stands for the word
+		// ranksOfLengthBegin(length)[j]. Each row is getBitsetRowWords(length) words long, padded with
+		// zeros, ready for the kernels in Bitset.h.
+		size_t getBitsetRowWords(unsigned int length) const { return bitsetRowWords(ranksOfLengthEnd(length) - ranksOfLengthBegin(length)); }
+		const uint64_t* wordsWithLetter(unsigned int length, char letter) const { return bitsets + bitsetStarts[length] + (letter - 'a') * getBitsetRowWords(length); } // letter anywhere
+		const uint64_t* wordsWithLetterAt(unsigned int length, unsigned int position, char letter) const { return bitsets + bitsetStarts[length] + (26 * (position + 1) + (letter - 'a')) * getBitsetRowWords(length); }
 		void scoreWords(); // score all words
-		std::string getWordAtLevel(unsigned int level); // higher level = harder
+		std::string getWordAtLevel(unsigned int level) const; // random word of a level (1 to NUM_LEVELS); higher level = harder
+		uint32_t getLevelBegin(unsigned int level) const { return (uint32_t)levelIndices[std::max(1U, std::min(level, (unsigned int)NUM_LEVELS)) - 1]; } // first rank of a level
+		uint32_t getLevelEnd(unsigned int level) const { return (uint32_t)levelIndices[std::max(1U, std::min(level, (unsigned int)NUM_LEVELS))]; } // one past its last rank
 };
 
 #endif
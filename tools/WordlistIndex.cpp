@@ -0,0 +1,44 @@
+#include "../src/Words.h"
+#include "../src/WordIndex.h"
+#include <chrono>
+
+// Offline compile step for the wordlist: reads and scores the text wordlist once and
+// saves the result as a binary index that the server maps at startup (see WordIndex.h).
+// The index remembers the size and modification time of its source, so the server falls
+// back to the text wordlist if the index is stale.
+//
+// Usage: bin/WordlistIndex [WORDLIST.txt] [INDEX.idx]
+
+int main(int argc, char** argv){
+	std::string source = (argc > 1 ? argv[1] : WORDLIST_PATH);
+	std::string path = (argc > 2 ? argv[2] : WORDLIST_INDEX_PATH);
+
+	auto start = std::chrono::steady_clock::now();
+	Wordlist list;
+	if(!list.readWordlist(source)){
+		std::cerr << "Error: Could not open wordlist." << std::endl;
+		return 1;
+	}
+	list.scoreWords();
+	if(!list.writeIndex(path, source)) return 1;
+	double builtMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	// Check the result the way the server will read it.
+	start = std::chrono::steady_clock::now();
+	Wordlist check;
+	WordRange expected = list.getSortedWords();
+	if(!check.loadIndex(path, source) || !std::equal(expected.begin(), expected.end(), check.getSortedWords().begin(), check.getSortedWords().end())){
+		std::cerr << "Error: '" << path << "' does not read back correctly." << std::endl;
+		return 1;
+	}
+	double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	for(uint32_t rank = 0; rank < expected.size(); rank++){
+		if(check.getRank(expected[rank]) != (long)rank){
+			std::cerr << "Error: The rank table in '" << path << "' does not find '" << expected[rank] << "'." << std::endl;
+			return 1;
+		}
+	}
+	std::cout << "Wrote " << list.getSortedWords().size() << " words to '" << path << "' (text path " << builtMs;
+	std::cout << " ms, index load " << loadMs << " ms)." << std::endl;
+	return 0;
+}